@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace {
+	struct Counter {
+		std::size_t count;
+		std::size_t size;
+		std::size_t release;
+		int suspended;
+	};
+
+	// trivially constructible so that it can be touched from inside malloc
+	thread_local Counter counter;
+
+	struct Total {
+		const char* label;
+		std::size_t scope;
+		std::size_t count;
+		std::size_t size;
+		std::size_t release;
+	};
+
+	class Summary {
+		static constexpr int capacity = 32;
+
+		std::mutex lock;
+		Total total[capacity]{};
+		int used = 0;
+
+	public:
+		void record(const char* label, const std::size_t count, const std::size_t size, const std::size_t release) {
+			std::lock_guard guard(lock);
+
+			auto I = 0;
+			while(I < used && std::strcmp(total[I].label, label) != 0) ++I;
+			if(I == capacity) return;
+			if(I == used) total[used++].label = label;
+
+			++total[I].scope;
+			total[I].count += count;
+			total[I].size += size;
+			total[I].release += release;
+		}
+
+		~Summary() {
+			for(auto I = 0; I < used; ++I) {
+				const auto& t = total[I];
+				std::fprintf(stderr, "[alloc] summary %s: %zu scopes, %zu allocations, %zu bytes, %zu frees, %.1f allocations per scope\n", t.label, t.scope, t.count, t.size, t.release, static_cast<double>(t.count) / static_cast<double>(t.scope));
+			}
+		}
+	};
+
+	Summary summary;
+
+#ifdef FMC_TRACK_ALLOCATION
+	void record_allocation(const std::size_t size) {
+		if(counter.suspended != 0) return;
+		++counter.count;
+		counter.size += size;
+	}
+
+	void record_release(const void* ptr) {
+		if(ptr == nullptr || counter.suspended != 0) return;
+		++counter.release;
+	}
+#endif
+}
+
+AllocationScope::AllocationScope(const char* L)
+	: label(L)
+	, count(counter.count)
+	, size(counter.size)
+	, release(counter.release) {}
+
+AllocationScope::~AllocationScope() {
+	const auto t_count = counter.count - count;
+	const auto t_size = counter.size - size;
+	const auto t_release = counter.release - release;
+
+	++counter.suspended;
+#ifdef FMC_TRACK_ALLOCATION_SCOPE
+	std::fprintf(stderr, "[alloc] %s: %zu allocations, %zu bytes, %zu frees\n", label, t_count, t_size, t_release);
+#endif
+	summary.record(label, t_count, t_size, t_release);
+	--counter.suspended;
+}
+
+#ifdef FMC_TRACK_ALLOCATION
+
+#ifdef __GLIBC__
+
+// With glibc the allocator itself can be interposed from the executable.
+// This also catches the payloads of Qt containers, which are obtained with malloc rather than operator new.
+// Operator new in libstdc++ forwards to malloc, so it does not need to be replaced as well.
+// Every way of obtaining a block that free releases is replaced, so that frees match the allocations counted.
+
+extern "C" {
+void* __libc_malloc(std::size_t);
+void* __libc_calloc(std::size_t, std::size_t);
+void* __libc_realloc(void*, std::size_t);
+void* __libc_memalign(std::size_t, std::size_t);
+void* __libc_valloc(std::size_t);
+void* __libc_pvalloc(std::size_t);
+void __libc_free(void*);
+
+void* malloc(const std::size_t size) {
+	record_allocation(size);
+	return __libc_malloc(size);
+}
+
+void* calloc(const std::size_t num, const std::size_t size) {
+	record_allocation(num * size);
+	return __libc_calloc(num, size);
+}
+
+// the old block counts as freed and the new one as allocated, shrinking to nothing only frees
+void* realloc(void* ptr, const std::size_t size) {
+	record_release(ptr);
+	if(ptr == nullptr || size != 0) record_allocation(size);
+	return __libc_realloc(ptr, size);
+}
+
+void* memalign(const std::size_t alignment, const std::size_t size) {
+	record_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(const std::size_t alignment, const std::size_t size) {
+	record_allocation(size);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, const std::size_t alignment, const std::size_t size) {
+	if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+	record_allocation(size);
+	auto* block = __libc_memalign(alignment, size);
+	if(block == nullptr) return ENOMEM;
+	*ptr = block;
+	return 0;
+}
+
+void* valloc(const std::size_t size) {
+	record_allocation(size);
+	return __libc_valloc(size);
+}
+
+void* pvalloc(const std::size_t size) {
+	record_allocation(size);
+	return __libc_pvalloc(size);
+}
+
+void free(void* ptr) {
+	record_release(ptr);
+	__libc_free(ptr);
+}
+}
+
+#else
+
+// Elsewhere only allocations going through operator new can be seen.
+
+void* operator new(const std::size_t size) {
+	record_allocation(size);
+	if(auto* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size) { return operator new(size); }
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+	record_allocation(size);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* ptr) noexcept {
+	record_release(ptr);
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+
+void operator delete[](void* ptr, std::size_t) noexcept { operator delete(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }
+
+#endif
+
+#endif
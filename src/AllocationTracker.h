@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <cstddef>
+
+// Counts heap allocations made on the current thread while alive.
+// The hooks are only compiled in with FMC_TRACK_ALLOCATION defined.
+// A per-label summary is printed to stderr when the program ends.
+// With FMC_TRACK_ALLOCATION_SCOPE defined as well, each scope also prints one line on exit.
+class AllocationScope final {
+public:
+	explicit AllocationScope(const char*);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope&) = delete;
+	AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+	const char* label;
+
+	std::size_t count;
+	std::size_t size;
+	std::size_t release;
+};
+
+#ifdef FMC_TRACK_ALLOCATION
+#define FMC_ALLOCATION_SCOPE(label) const AllocationScope allocation_scope(label)
+#else
+#define FMC_ALLOCATION_SCOPE(label)
+#endif
+
+#endif // ALLOCATIONTRACKER_H
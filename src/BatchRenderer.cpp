@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+
+#include <Database.h>
+#include <QApplication>
+#include <QFileInfo>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+
+namespace {
+	PlotSetting::PlotView rotation(const float XR, const float YR, const float ZR) {
+		PlotSetting::PlotView view;
+		view.XR = XR;
+		view.YR = YR;
+		view.ZR = ZR;
+		return view;
+	}
+
+	std::shared_ptr<Database> load(const QString& path) {
+		auto model = std::make_shared<Database>();
+		if(!model->loadModel(path)) model.reset();
+		return model;
+	}
+} // namespace
+
+const std::vector<BatchRenderer::Preset>& BatchRenderer::presets() {
+	// the isometric view tilts by the angle between a body diagonal and the ground
+	static const std::vector<Preset> all{
+		{"plan", rotation(0.f, 0.f, 0.f)},
+		{"front", rotation(-90.f, 0.f, 0.f)},
+		{"side", rotation(-90.f, 0.f, -90.f)},
+		{"iso", rotation(-54.7356f, 0.f, -45.f)},
+	};
+	return all;
+}
+
+BatchRenderer::BatchRenderer(const QSize& S, const QString& D)
+	: size(S)
+	, output(D) {
+	// the canvas only provides the context, nothing is ever put on screen
+	canvas.setAttribute(Qt::WA_DontShowOnScreen);
+	canvas.resize(size);
+}
+
+int BatchRenderer::run(const QStringList& models, const QStringList& views) {
+	std::vector<const Preset*> chosen;
+	for(const auto& name : views) {
+		const auto& all = presets();
+		const auto found = std::find_if(all.cbegin(), all.cend(), [&](const Preset& P) { return P.first == name; });
+		if(found == all.cend()) std::fprintf(stderr, "[batch] unknown view %s\n", qUtf8Printable(name));
+		else chosen.emplace_back(&*found);
+	}
+
+	if(chosen.empty() || models.isEmpty()) return 0;
+
+	if(!output.exists() && !output.mkpath(".")) {
+		std::fprintf(stderr, "[batch] cannot create %s\n", qUtf8Printable(output.path()));
+		return 0;
+	}
+
+	// initializeGL runs when the widget is first shown
+	canvas.show();
+	QApplication::processEvents();
+	if(!canvas.isValid()) {
+		std::fprintf(stderr, "[batch] no OpenGL context\n");
+		return 0;
+	}
+
+	int written = 0;
+
+	// writes are bounded so that encoded images do not pile up when the disk is slower than the renderer
+	std::deque<QFuture<bool>> pending;
+	const auto limit = static_cast<std::size_t>(std::max(2, 2 * QThreadPool::globalInstance()->maxThreadCount()));
+	auto settle = [&](const std::size_t remain) {
+		while(pending.size() > remain) {
+			if(pending.front().result()) ++written;
+			pending.pop_front();
+		}
+	};
+
+	// the next model is read while the current one is drawn
+	auto next = QtConcurrent::run(load, models.first());
+	for(auto I = 0; I < models.size(); ++I) {
+		auto model = next.result();
+		if(I + 1 < models.size()) next = QtConcurrent::run(load, models.at(I + 1));
+
+		const auto& path = models.at(I);
+		if(!model) {
+			std::fprintf(stderr, "[batch] cannot load %s\n", qUtf8Printable(path));
+			continue;
+		}
+
+		canvas.setModel(model.get());
+		// the previous model is released only once the canvas has let go of it
+		current = std::move(model);
+
+		const auto base = QFileInfo(path).completeBaseName();
+		for(const auto* preset : chosen) {
+			canvas.setCamera(preset->second);
+			auto image = canvas.renderImage(size);
+			if(image.isNull()) {
+				std::fprintf(stderr, "[batch] cannot render %s from %s\n", qUtf8Printable(path), qUtf8Printable(preset->first));
+				continue;
+			}
+
+			const auto file = output.filePath(QString("%1_%2.png").arg(base, preset->first));
+			settle(limit - 1);
+			pending.emplace_back(QtConcurrent::run([image = std::move(image), file] {
+				if(image.save(file, "PNG")) return true;
+				std::fprintf(stderr, "[batch] cannot write %s\n", qUtf8Printable(file));
+				return false;
+			}));
+		}
+	}
+
+	settle(0);
+
+	canvas.setModel(nullptr);
+	current.reset();
+
+	return written;
+}
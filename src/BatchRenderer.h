@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <ModelRenderer.h>
+#include <QDir>
+#include <QSize>
+#include <QStringList>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Draws images of many models from standard views through a canvas that is never put on screen.
+// The next model is read on the thread pool while the current one is drawn, images are written there as they come.
+// Without a display it runs on the offscreen platform or a virtual one, with software OpenGL such as llvmpipe.
+class BatchRenderer {
+public:
+	using Preset = std::pair<QString, PlotSetting::PlotView>;
+
+	// plan from above, front from -y, side from +x and isometric, only the rotation is used
+	static const std::vector<Preset>& presets();
+
+	BatchRenderer(const QSize&, const QString&);
+
+	// Writes one image per model and view into the output folder as NAME_VIEW.png, returns the number written.
+	// Unknown views and models that fail to load are reported on stderr and skipped.
+	int run(const QStringList&, const QStringList&);
+
+private:
+	QSize size;
+	QDir output;
+
+	ModelRenderer canvas;
+	// the canvas keeps a plain pointer, so the model being drawn is held here
+	std::shared_ptr<Database> current;
+};
+
+#endif // BATCHRENDERER_H
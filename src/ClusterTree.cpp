@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ClusterTree.h"
+#include <QVector4D>
+#include <QtConcurrent>
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace {
+	// below this many items a subtree is split on the calling thread
+	constexpr std::uint32_t parallel_size = 16384;
+}
+
+void ClusterTree::Box::expand(const Box& other) {
+	for(auto I = 0; I < 3; ++I) {
+		lower[I] = std::min(lower[I], other.lower[I]);
+		upper[I] = std::max(upper[I], other.upper[I]);
+	}
+}
+
+void ClusterTree::build(const std::vector<Box>& item) {
+	const auto item_num = static_cast<std::uint32_t>(item.size());
+
+	order.resize(item_num);
+	std::iota(order.begin(), order.end(), 0u);
+
+	if(0 == item_num) {
+		cluster.clear();
+		return;
+	}
+
+	std::vector<QVector3D> centre;
+	centre.reserve(item_num);
+	for(const auto& [lower, upper] : item) centre.emplace_back(.5f * (lower + upper));
+
+	// halves are always split at the middle, so the shape of the tree depends on the number of items only
+	// every subtree knows where it goes before it is built, which lets both halves be built at the same time
+	cluster.assign(countCluster(item_num), Cluster());
+
+	split(0, 0, item_num, centre);
+
+	fit(item);
+}
+
+void ClusterTree::refit(const std::vector<Box>& item) {
+	if(item.size() != order.size()) build(item);
+	else fit(item);
+}
+
+void ClusterTree::clear() {
+	cluster.clear();
+	order.clear();
+}
+
+const std::vector<std::uint32_t>& ClusterTree::getOrder() const { return order; }
+
+std::uint32_t ClusterTree::size() const { return static_cast<std::uint32_t>(order.size()); }
+
+void ClusterTree::cull(const QMatrix4x4& trans, const float margin, std::vector<Range>& range) const {
+	if(cluster.empty()) return;
+
+	// planes of the frustum taken from the rows of the projection, pointing inwards
+	const auto w = trans.row(3);
+	const std::array<QVector4D, 6> plane{w + trans.row(0), w - trans.row(0), w + trans.row(1), w - trans.row(1), w + trans.row(2), w - trans.row(2)};
+
+	const auto push = [&](const Cluster& node) {
+		if(!range.empty() && range.back().first + range.back().second == node.first) range.back().second += node.count;
+		else range.emplace_back(node.first, node.count);
+	};
+
+	// halving keeps the depth below the number of bits in a count, and each level leaves at most one node waiting
+	std::array<std::uint32_t, 64> stack{};
+	auto top = 1llu;
+	while(top > 0) {
+		const auto index = stack[--top];
+		const auto& node = cluster[index];
+
+		const auto lower = node.box.lower - QVector3D(margin, margin, margin);
+		const auto upper = node.box.upper + QVector3D(margin, margin, margin);
+
+		auto outside = false, inside = true;
+		for(const auto& P : plane) {
+			// the corners furthest along and against the normal of the plane
+			QVector3D far_corner, near_corner;
+			for(auto I = 0; I < 3; ++I) {
+				far_corner[I] = P[I] >= 0.f ? upper[I] : lower[I];
+				near_corner[I] = P[I] >= 0.f ? lower[I] : upper[I];
+			}
+			if(QVector3D::dotProduct(P.toVector3D(), far_corner) + P.w() < 0.f) {
+				outside = true;
+				break;
+			}
+			if(QVector3D::dotProduct(P.toVector3D(), near_corner) + P.w() < 0.f) inside = false;
+		}
+
+		if(outside) continue;
+
+		if(inside || 0 == node.right) push(node);
+		else {
+			// left is visited first so that the ranges come out in order
+			stack[top++] = node.right;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+std::uint32_t ClusterTree::countCluster(const std::uint32_t item_num) {
+	if(item_num <= leaf_size) return 1;
+
+	const auto half = item_num / 2;
+
+	return 1 + countCluster(half) + countCluster(item_num - half);
+}
+
+void ClusterTree::split(const std::uint32_t index, const std::uint32_t first, const std::uint32_t item_num, const std::vector<QVector3D>& centre) {
+	auto& node = cluster[index];
+	node.first = first;
+	node.count = item_num;
+
+	if(item_num <= leaf_size) return;
+
+	// cut across the longest side of the box around the centres
+	auto lower = centre[order[first]], upper = lower;
+	for(auto I = first + 1; I < first + item_num; ++I)
+		for(auto J = 0; J < 3; ++J) {
+			lower[J] = std::min(lower[J], centre[order[I]][J]);
+			upper[J] = std::max(upper[J], centre[order[I]][J]);
+		}
+
+	const auto extent = upper - lower;
+	const auto axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 : extent.y() >= extent.z() ? 1 : 2;
+
+	const auto half = item_num / 2;
+	const auto begin = order.begin() + first;
+	std::nth_element(begin, begin + half, begin + item_num, [&](const std::uint32_t a, const std::uint32_t b) { return centre[a][axis] < centre[b][axis]; });
+
+	const auto left = index + 1;
+	const auto right = left + countCluster(half);
+	node.right = right;
+
+	if(item_num < parallel_size) {
+		split(left, first, half, centre);
+		split(right, first + half, item_num - half, centre);
+		return;
+	}
+
+	// both halves touch disjoint parts of the order and of the tree
+	auto future = QtConcurrent::run([&, left, first, half] { split(left, first, half, centre); });
+	split(right, first + half, item_num - half, centre);
+	future.waitForFinished();
+}
+
+void ClusterTree::fit(const std::vector<Box>& item) {
+	// children are stored after their parent, so walking backwards sees them first
+	for(auto I = cluster.size(); I > 0; --I) {
+		auto& node = cluster[I - 1];
+		if(0 == node.right) {
+			node.box = item[order[node.first]];
+			for(auto J = node.first + 1; J < node.first + node.count; ++J) node.box.expand(item[order[J]]);
+		} else {
+			node.box = cluster[I].box;
+			node.box.expand(cluster[node.right].box);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLUSTERTREE_H
+#define CLUSTERTREE_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Bounding volume hierarchy over a set of boxes, used to skip whatever lies outside the view frustum.
+// Items are put in tree order so that every subtree covers a contiguous range of them.
+// Buffers laid out in that order can be drawn one range per visible cluster.
+class ClusterTree {
+public:
+	struct Box {
+		QVector3D lower, upper;
+
+		void expand(const Box&);
+	};
+
+	// first position and number of items
+	using Range = std::pair<std::uint32_t, std::uint32_t>;
+
+	// Items are reordered, the original index of the item at each position is given by getOrder().
+	// Large sets are split on the thread pool.
+	void build(const std::vector<Box>&);
+	// Same items at new places, the tree and the order are kept and only the boxes are updated.
+	void refit(const std::vector<Box>&);
+	void clear();
+
+	[[nodiscard]] const std::vector<std::uint32_t>& getOrder() const;
+	[[nodiscard]] std::uint32_t size() const;
+
+	// Appends the ranges of items in clusters that may be seen through the given projection.
+	// Boxes are grown by the margin first, for things drawn around the items.
+	// Adjacent ranges are merged, a model that is fully in view gives one range.
+	void cull(const QMatrix4x4&, float, std::vector<Range>&) const;
+
+private:
+	static constexpr std::uint32_t leaf_size = 128;
+
+	struct Cluster {
+		Box box;
+		std::uint32_t first = 0, count = 0;
+		// the left child always follows its parent, the right child is stored here, zero for leaves
+		std::uint32_t right = 0;
+	};
+
+	std::vector<Cluster> cluster;
+	std::vector<std::uint32_t> order;
+
+	static std::uint32_t countCluster(std::uint32_t);
+	void split(std::uint32_t, std::uint32_t, std::uint32_t, const std::vector<QVector3D>&);
+	void fit(const std::vector<Box>&);
+};
+
+#endif // CLUSTERTREE_H
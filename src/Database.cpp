@@ -16,22 +16,27 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "Database.h"
+#include <AllocationTracker.h>
 #include <QFile>
-#include <QRegularExpression>
+#include <QSaveFile>
+#include <Schema.h>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
 
-const std::unordered_map<int, Database::Node>& Database::getNodePool() const { return node_pool; }
+const std::unordered_map<int, Database::Node>& Database::getNodePool() const { return *node_pool; }
 
-const std::unordered_map<int, Database::WallSection>& Database::getWallSectionPool() const { return wall_section_pool; }
+const std::unordered_map<int, Database::WallSection>& Database::getWallSectionPool() const { return *wall_section_pool; }
 
-const std::unordered_map<int, Database::FrameSection>& Database::getFrameSectionPool() const { return frame_section_pool; }
+const std::unordered_map<int, Database::FrameSection>& Database::getFrameSectionPool() const { return *frame_section_pool; }
 
-const std::unordered_map<int, Database::Element>& Database::getElementPool() const { return element_pool; }
+const std::unordered_map<int, Database::Element>& Database::getElementPool() const { return *element_pool; }
 
 QVector<int> Database::getNodeTag() const {
 	QVector<int> pool;
 
-	pool.reserve(static_cast<int>(node_pool.size()));
-	for(auto& [fst, snd] : node_pool) pool.append(fst);
+	pool.reserve(static_cast<int>(node_pool->size()));
+	for(auto& [fst, snd] : *node_pool) pool.append(fst);
 	std::sort(pool.begin(), pool.end());
 
 	return pool;
@@ -40,8 +45,8 @@ QVector<int> Database::getNodeTag() const {
 QVector<int> Database::getWallSectionTag() const {
 	QVector<int> pool;
 
-	pool.reserve(static_cast<int>(wall_section_pool.size()));
-	for(auto& [fst, snd] : wall_section_pool) pool.append(fst);
+	pool.reserve(static_cast<int>(wall_section_pool->size()));
+	for(auto& [fst, snd] : *wall_section_pool) pool.append(fst);
 	std::sort(pool.begin(), pool.end());
 
 	return pool;
@@ -50,8 +55,8 @@ QVector<int> Database::getWallSectionTag() const {
 QVector<int> Database::getFrameSectionTag() const {
 	QVector<int> pool;
 
-	pool.reserve(static_cast<int>(frame_section_pool.size()));
-	for(auto& [fst, snd] : frame_section_pool) pool.append(fst);
+	pool.reserve(static_cast<int>(frame_section_pool->size()));
+	for(auto& [fst, snd] : *frame_section_pool) pool.append(fst);
 	std::sort(pool.begin(), pool.end());
 
 	return pool;
@@ -60,8 +65,8 @@ QVector<int> Database::getFrameSectionTag() const {
 QVector<int> Database::getElementTag() const {
 	QVector<int> pool;
 
-	pool.reserve(static_cast<int>(element_pool.size()));
-	for(auto& [fst, snd] : element_pool) pool.append(fst);
+	pool.reserve(static_cast<int>(element_pool->size()));
+	for(auto& [fst, snd] : *element_pool) pool.append(fst);
 	std::sort(pool.begin(), pool.end());
 
 	return pool;
@@ -70,7 +75,7 @@ QVector<int> Database::getElementTag() const {
 int Database::getNextNodeTag() {
 	auto tag = 0;
 
-	for(auto& [fst, snd] : node_pool) if(fst > tag) tag = fst;
+	for(auto& [fst, snd] : *node_pool) if(fst > tag) tag = fst;
 
 	return tag + 1;
 }
@@ -78,7 +83,7 @@ int Database::getNextNodeTag() {
 int Database::getNextWallSectionTag() {
 	auto tag = 0;
 
-	for(auto& [fst, snd] : wall_section_pool) if(fst > tag) tag = fst;
+	for(auto& [fst, snd] : *wall_section_pool) if(fst > tag) tag = fst;
 
 	return tag + 1;
 }
@@ -86,7 +91,7 @@ int Database::getNextWallSectionTag() {
 int Database::getNextFrameSectionTag() {
 	auto tag = 0;
 
-	for(auto& [fst, snd] : frame_section_pool) if(fst > tag) tag = fst;
+	for(auto& [fst, snd] : *frame_section_pool) if(fst > tag) tag = fst;
 
 	return tag + 1;
 }
@@ -94,59 +99,133 @@ int Database::getNextFrameSectionTag() {
 int Database::getNextElementTag() {
 	auto tag = 0;
 
-	for(auto& [fst, snd] : element_pool) if(fst > tag) tag = fst;
+	for(auto& [fst, snd] : *element_pool) if(fst > tag) tag = fst;
 
 	return tag + 1;
 }
 
 bool Database::removeNode(const int T) {
-	auto I = element_pool.begin();
-	while(I != element_pool.end()) {
-		if(I->second.encoding.count(T) > 0) I = element_pool.erase(I);
-		else ++I;
+	const auto t_node = node_pool->find(T);
+	if(t_node == node_pool->end()) return false;
+
+	const auto shrink = bounds.touches(t_node->second.position);
+
+	auto deselected = false;
+
+	auto& t_pool = element_pool.write();
+	auto I = t_pool.begin();
+	while(I != t_pool.end()) {
+		if(std::count(I->second.encoding.cbegin(), I->second.encoding.cend(), T) > 0) {
+			deselected |= deselect(element_selection, I->first);
+			I = t_pool.erase(I);
+		} else ++I;
 	}
 
-	return 1 == node_pool.erase(T);
+	node_pool.write().erase(T);
+	deselected |= deselect(node_selection, T);
+
+	if(shrink) updateBounds();
+	if(deselected) selection_stale = true;
+
+	return true;
 }
 
 bool Database::removeWallSection(const int T) {
-	auto I = element_pool.begin();
-	while(I != element_pool.end()) {
-		if(I->second.type == Element::Type::Wall && I->second.section_tag == T) I = element_pool.erase(I);
-		else ++I;
+	if(wall_section_pool->find(T) == wall_section_pool->end()) return false;
+
+	auto deselected = false;
+
+	auto& t_pool = element_pool.write();
+	auto I = t_pool.begin();
+	while(I != t_pool.end()) {
+		if(I->second.type == Element::Type::Wall && I->second.section_tag == T) {
+			deselected |= deselect(element_selection, I->first);
+			I = t_pool.erase(I);
+		} else ++I;
 	}
 
-	return 1 == wall_section_pool.erase(T);
+	if(deselected) selection_stale = true;
+
+	return 1 == wall_section_pool.write().erase(T);
 }
 
 bool Database::removeFrameSection(const int T) {
-	auto I = element_pool.begin();
-	while(I != element_pool.end()) {
-		if(I->second.type != Element::Type::Wall && I->second.section_tag == T) I = element_pool.erase(I);
-		else ++I;
+	if(frame_section_pool->find(T) == frame_section_pool->end()) return false;
+
+	auto deselected = false;
+
+	auto& t_pool = element_pool.write();
+	auto I = t_pool.begin();
+	while(I != t_pool.end()) {
+		if(I->second.type != Element::Type::Wall && I->second.section_tag == T) {
+			deselected |= deselect(element_selection, I->first);
+			I = t_pool.erase(I);
+		} else ++I;
 	}
 
-	return 1 == frame_section_pool.erase(T);
+	if(deselected) selection_stale = true;
+
+	return 1 == frame_section_pool.write().erase(T);
 }
 
-bool Database::removeElement(const int T) { return 1 == element_pool.erase(T); }
+bool Database::removeElement(const int T) {
+	if(element_pool->find(T) == element_pool->end()) return false;
 
-void Database::changePosition(const int tag, QVector3D&& position) { if(node_pool.find(tag) != node_pool.end()) node_pool[tag].position = position; }
+	const auto deselected = deselect(element_selection, T);
 
-void Database::changeFixity(const int tag, QVector<bool>&& fixity) { if(node_pool.find(tag) != node_pool.end()) node_pool[tag].fixity = fixity; }
+	const auto erased = 1 == element_pool.write().erase(T);
+
+	if(deselected) selection_stale = true;
+
+	return erased;
+}
 
-void Database::changeLoad(const int tag, QVector<double>&& load) { if(node_pool.find(tag) != node_pool.end()) node_pool[tag].load = load; }
+void Database::changePosition(const int tag, QVector3D&& position) {
+	const auto t_node = node_pool->find(tag);
+	if(t_node == node_pool->end()) return;
 
-void Database::changeMass(const int tag, const double mass) { if(node_pool.find(tag) != node_pool.end()) node_pool[tag].mass = mass; }
+	const auto shrink = bounds.touches(t_node->second.position);
 
-void Database::changeDisplacement(const int tag, QVector<double>&& displacement) { if(node_pool.find(tag) != node_pool.end()) node_pool[tag].displacement = displacement; }
+	// a node inside the selection box before and after cannot change it, whether selected or not
+	touchSelection(t_node->second.position);
+	touchSelection(position);
+
+	node_pool.write()[tag].position = position;
+
+	if(shrink) updateBounds();
+	else bounds.expand(position);
+}
+
+void Database::changeFixity(const int tag, std::array<bool, 6>&& fixity) { if(node_pool->find(tag) != node_pool->end()) node_pool.write()[tag].fixity = fixity; }
+
+void Database::changeLoad(const int tag, std::array<double, 6>&& load) { if(node_pool->find(tag) != node_pool->end()) node_pool.write()[tag].load = load; }
+
+void Database::changeMass(const int tag, const double mass) { if(node_pool->find(tag) != node_pool->end()) node_pool.write()[tag].mass = mass; }
+
+void Database::changeDisplacement(const int tag, std::array<double, 6>&& displacement) { if(node_pool->find(tag) != node_pool->end()) node_pool.write()[tag].displacement = displacement; }
+
+void Database::clearFixity() {
+	for(auto& [fst, snd] : node_pool.write()) snd.fixity = {};
+}
+
+void Database::clearLoad() {
+	for(auto& [fst, snd] : node_pool.write()) snd.load = {};
+}
+
+void Database::clearMass() {
+	for(auto& [fst, snd] : node_pool.write()) snd.mass = 0.;
+}
+
+void Database::clearDisplacement() {
+	for(auto& [fst, snd] : node_pool.write()) snd.displacement = {};
+}
 
 void Database::changeSection(const int ele, const int sec) {
-	if(element_pool.find(ele) == element_pool.end()) return;
+	if(element_pool->find(ele) == element_pool->end()) return;
 
-	if(element_pool.at(ele).type == Element::Type::Wall) { if(wall_section_pool.find(sec) == wall_section_pool.end()) return; } else if(frame_section_pool.find(sec) == frame_section_pool.end()) return;
+	if(element_pool->at(ele).type == Element::Type::Wall) { if(wall_section_pool->find(sec) == wall_section_pool->end()) return; } else if(frame_section_pool->find(sec) == frame_section_pool->end()) return;
 
-	element_pool[ele].section_tag = sec;
+	element_pool.write()[ele].section_tag = sec;
 }
 
 void Database::changeUnit(const int F) { unit_system = F; }
@@ -166,12 +245,13 @@ void Database::changeAccxRecord(const QString& F) { acc_record[0] = F; }
 void Database::changeAccyRecord(const QString& F) { acc_record[1] = F; }
 
 void Database::splitElement(const int tag, const int segment) {
-	if(element_pool.find(tag) == element_pool.end()) return;
+	if(element_pool->find(tag) == element_pool->end()) return;
 
-	auto& t_element = element_pool[tag];
+	auto& t_pool = element_pool.write();
+	auto& t_element = t_pool[tag];
 
-	const auto& coor_i = node_pool[t_element.encoding.at(0)].position;
-	const auto& coor_j = node_pool[t_element.encoding.at(1)].position;
+	const auto coor_i = node_pool->at(t_element.encoding.at(0)).position;
+	const auto coor_j = node_pool->at(t_element.encoding.at(1)).position;
 
 	auto node_tag = getNextNodeTag();
 
@@ -182,19 +262,17 @@ void Database::splitElement(const int tag, const int segment) {
 
 	auto element_tag = getNextElementTag();
 
-	t_element.highlighted = false;
-
 	auto element_copy = t_element;
 
 	element_copy.encoding[1] = node_tag;
 
-	element_pool.try_emplace(element_tag++, element_copy);
+	t_pool.try_emplace(element_tag++, element_copy);
 
 	element_copy = t_element;
 
 	element_copy.encoding[0] = node_tag + segment - 2;
 
-	element_pool.try_emplace(element_tag++, element_copy);
+	t_pool.try_emplace(element_tag++, element_copy);
 
 	for(auto I = 0; I < segment - 2; ++I) {
 		element_copy = t_element;
@@ -202,134 +280,214 @@ void Database::splitElement(const int tag, const int segment) {
 		element_copy.encoding[0] = node_tag++;
 		element_copy.encoding[1] = node_tag;
 
-		element_pool.try_emplace(element_tag++, element_copy);
+		t_pool.try_emplace(element_tag++, element_copy);
 	}
 
 	removeElement(tag);
 }
 
-void Database::removeElement() { element_pool.clear(); }
+void Database::removeElement() {
+	element_pool.write().clear();
+	if(element_selection->empty()) return;
+	element_selection.write().clear();
+	selection_stale = true;
+}
+
+void Database::Bounds::expand(const QVector3D& position) {
+	if(empty) {
+		lower = upper = position;
+		empty = false;
+		return;
+	}
+
+	for(auto I = 0; I < 3; ++I) {
+		lower[I] = std::min(lower[I], position[I]);
+		upper[I] = std::max(upper[I], position[I]);
+	}
+}
+
+bool Database::Bounds::touches(const QVector3D& position) const {
+	if(empty) return false;
+
+	for(auto I = 0; I < 3; ++I)
+		if(position[I] <= lower[I] || position[I] >= upper[I]) return true;
+
+	return false;
+}
+
+QVector3D Database::Bounds::centre() const { return .5f * (lower + upper); }
+
+float Database::Bounds::radius() const { return .5f * (upper - lower).length(); }
+
+const Database::Bounds& Database::getBounds() const { return bounds; }
+
+const Database::Bounds& Database::getSelectionBounds() {
+	if(!selection_stale) return selection_bounds;
+
+	selection_stale = false;
+	selection_bounds = Bounds();
+
+	for(const auto tag : *node_selection)
+		if(const auto t_node = node_pool->find(tag); t_node != node_pool->end()) selection_bounds.expand(t_node->second.position);
+
+	for(const auto tag : *element_selection)
+		if(const auto t_element = element_pool->find(tag); t_element != element_pool->end())
+			for(const auto I : t_element->second.encoding) selection_bounds.expand(node_pool->at(I).position);
+
+	return selection_bounds;
+}
+
+bool Database::deselect(Shared<std::unordered_set<int>>& selection, const int tag) {
+	if(selection->count(tag) == 0) return false;
+	selection.write().erase(tag);
+	return true;
+}
+
+void Database::updateBounds() {
+	bounds = Bounds();
+	for(const auto& [fst, snd] : *node_pool) bounds.expand(snd.position);
+}
+
+void Database::touchSelection(const QVector3D& position) {
+	if(!selection_stale && selection_bounds.touches(position)) selection_stale = true;
+}
+
+std::shared_ptr<const Database> Database::snapshot() const { return std::make_shared<const Database>(*this); }
+
+std::uint64_t Database::getRevision() const { return std::max({node_pool.getRevision(), wall_section_pool.getRevision(), frame_section_pool.getRevision(), element_pool.getRevision()}); }
+
+std::uint64_t Database::getSelectionRevision() const { return std::max(node_selection.getRevision(), element_selection.getRevision()); }
+
+std::uint64_t Database::nextRevision() {
+	// shared by all instances so that a replaced model never looks unchanged
+	static std::atomic<std::uint64_t> counter{0};
+	return ++counter;
+}
+
+bool Database::loadModel(const QString& file_name, const Progress& progress) {
+	FMC_ALLOCATION_SCOPE("load");
 
-bool Database::loadModel(const QString& file_name) {
 	QFile file(file_name);
-	file.open(QIODevice::ReadOnly);
+	if(!file.open(QIODevice::ReadOnly)) return false;
 	QTextStream script(&file);
 
-	QString command;
-	QStringList pool;
+	auto section = 0;
+	auto proceed = [&]() { return !progress || progress(++section); };
 
-	auto skip_blank = [&]() {
-		while(true) {
-			command = remove_comment(script.readLine());
-			if(!command.isEmpty()) {
-				pool = command.split(" ");
+	// scratch space of this load, tokens are views into the current line so nothing is allocated per line
+	std::array<std::byte, 4096> buffer;
+	std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
 
-				auto I = pool.begin();
+	QString line;
+	std::pmr::vector<QStringView> pool(&arena);
+	pool.reserve(32);
 
-				while(I != pool.end()) {
-					if(I->isEmpty()) I = pool.erase(I);
-					else ++I;
-				}
-
-				if(!pool.isEmpty()) break;
-			}
+	auto skip_blank = [&]() {
+		while(true) {
+			if(!script.readLineInto(&line)) throw std::runtime_error("unexpected end of file");
+			tokenize(line, pool);
+			if(!pool.empty()) break;
 		}
 	};
 
+	auto integer = [&](const std::size_t I) { return Schema::to<int>(pool.at(I)); };
+	auto real = [&](const std::size_t I) { return Schema::to<double>(pool.at(I)); };
+
 	// title
 	skip_blank();
 
 	// frame quadrature
 	skip_blank();
-	quadrature_frame = {pool.at(0).toInt(), pool.at(1).toInt(), pool.at(2).toInt()};
+	quadrature_frame = {integer(0), integer(1), integer(2)};
 
 	// wall quadrature
 	skip_blank();
-	quadrature_wall = {pool.at(0).toInt(), pool.at(1).toInt()};
+	quadrature_wall = {integer(0), integer(1)};
 
 	// unit
 	skip_blank();
-	changeUnit(pool.at(0).toInt());
+	changeUnit(integer(0));
 
 	skip_blank();
-	changeAnalysisType(pool.at(0).toInt());
+	changeAnalysisType(integer(0));
 
 	skip_blank();
-	const auto accx = pool.at(0).toInt() == 1;
+	const auto accx = integer(0) == 1;
 	skip_blank();
-	const auto accy = pool.at(0).toInt() == 1;
+	const auto accy = integer(0) == 1;
 	skip_blank();
-	changeDamping(pool.at(0));
+	changeDamping(pool.at(0).toString());
 	skip_blank();
-	changeScale(pool.at(0));
+	changeScale(pool.at(0).toString());
 	if(accx) {
 		skip_blank();
-		changeAccxRecord(pool.at(0));
+		changeAccxRecord(pool.at(0).toString());
 	}
 	if(accy) {
 		skip_blank();
-		changeAccyRecord(pool.at(0));
+		changeAccyRecord(pool.at(0).toString());
 	}
 
 	skip_blank();
 
-	const auto node_num = pool.at(0).toInt();
-	const auto beam_num = pool.at(1).toInt();
-	const auto brace_num = pool.at(2).toInt();
-	const auto wall_num = pool.at(3).toInt();
-	const auto frame_type_num = pool.at(4).toInt();
-	const auto wall_type_num = pool.at(5).toInt();
+	const auto node_num = integer(0);
+	const auto beam_num = integer(1);
+	const auto brace_num = integer(2);
+	const auto wall_num = integer(3);
+	const auto frame_type_num = integer(4);
+	const auto wall_type_num = integer(5);
 
-	for(auto I = 0; I < node_num; ++I) {
-		skip_blank();
-		add<Node>(pool.at(0).toInt(), Node{QVector3D{pool.at(1).toFloat(), pool.at(2).toFloat(), pool.at(3).toFloat()}});
-	}
+	if(!proceed()) return false;
 
-	for(auto I = 0; I < frame_type_num; ++I) {
+	auto next_line = [&]() -> const std::pmr::vector<QStringView>& {
 		skip_blank();
-		add<FrameSection>(I + 1, FrameSection{pool.at(0), QVector<double>{pool.at(1).toDouble(), pool.at(2).toDouble(), pool.at(3).toDouble(), pool.at(4).toDouble()}});
-	}
+		return pool;
+	};
 
-	for(auto I = 0; I < wall_type_num; ++I) {
-		add<WallSection>(I + 1, WallSection{QVector<double>{}});
-		auto& t_section = wall_section_pool[I + 1];
-		for(auto J = 0; J < 3; ++J) {
-			skip_blank();
-			for(auto K = 0; K < 6; ++K) t_section.parameter.append(pool.at(K).toDouble());
-		}
-	}
+	node_pool.write().reserve(node_num);
+	element_pool.write().reserve(beam_num + brace_num + wall_num);
 
-	for(auto I = 0; I < beam_num; ++I) {
-		skip_blank();
-		add<Element>(getNextElementTag(), Element{pool.at(4).toInt(), QVector<int>{pool.at(2).toInt(), pool.at(3).toInt()}, "Frame", 0});
+	for(auto I = 0; I < node_num; ++I) {
+		auto [tag, node] = Schema::read<Node>(next_line);
+		add<Node>(tag, std::move(node));
 	}
 
-	for(auto I = 0; I < brace_num; ++I) {
-		skip_blank();
-		add<Element>(getNextElementTag(), Element{pool.at(4).toInt(), QVector<int>{pool.at(2).toInt(), pool.at(3).toInt()}, "Brace", 0});
-	}
+	if(!proceed()) return false;
 
-	for(auto I = 0; I < wall_num; ++I) {
-		skip_blank();
-		add<Element>(getNextElementTag(), Element{pool.at(3).toInt(), QVector<int>{pool.at(1).toInt(), pool.at(2).toInt()}, "Wall", pool.at(4).toInt()});
-	}
+	for(auto I = 0; I < frame_type_num; ++I) add<FrameSection>(I + 1, Schema::read<FrameSection>(next_line).second);
+
+	for(auto I = 0; I < wall_type_num; ++I) add<WallSection>(I + 1, Schema::read<WallSection>(next_line).second);
+
+	if(!proceed()) return false;
+
+	auto element_tag = getNextElementTag();
+
+	for(auto I = 0; I < beam_num; ++I) if(add<Element>(element_tag, Schema::read<Element, Element::Type::Frame>(next_line).second)) ++element_tag;
+
+	for(auto I = 0; I < brace_num; ++I) if(add<Element>(element_tag, Schema::read<Element, Element::Type::Brace>(next_line).second)) ++element_tag;
+
+	for(auto I = 0; I < wall_num; ++I) if(add<Element>(element_tag, Schema::read<Element, Element::Type::Wall>(next_line).second)) ++element_tag;
+
+	if(!proceed()) return false;
 
 	skip_blank();
 
-	const auto mass_num = pool.at(0).toInt();
+	const auto mass_num = integer(0);
 
 	for(auto I = 0; I < mass_num; ++I) {
 		skip_blank();
-		changeMass(pool.at(1).toInt(), pool.at(2).toDouble());
+		changeMass(integer(1), real(2));
 	}
 
+	if(!proceed()) return false;
+
 	skip_blank();
 
-	const auto bc_num = pool.at(0).toInt();
+	const auto bc_num = integer(0);
 
 	for(auto I = 0; I < bc_num; ++I) {
 		skip_blank();
-		changeFixity(pool.at(1).toInt(), QVector<bool>{pool.at(4).toInt() != 0, pool.at(5).toInt() != 0, pool.at(6).toInt() != 0, pool.at(7).toInt() != 0, pool.at(8).toInt() != 0, pool.at(9).toInt() != 0});
+		changeFixity(integer(1), {integer(4) != 0, integer(5) != 0, integer(6) != 0, integer(7) != 0, integer(8) != 0, integer(9) != 0});
 	}
 
 	skip_blank();
@@ -337,23 +495,33 @@ bool Database::loadModel(const QString& file_name) {
 	skip_blank();
 
 	skip_blank();
-	tolerance[0] = pool.at(0).toDouble();
-	tolerance[1] = pool.at(1).toDouble();
-	tolerance[2] = pool.at(2).toDouble();
+	tolerance[0] = real(0);
+	tolerance[1] = real(1);
+	tolerance[2] = real(2);
 
 	skip_blank();
-	tolerance[3] = pool.at(0).toDouble();
-	tolerance[4] = pool.at(1).toDouble();
-	tolerance[5] = pool.at(2).toDouble();
+	tolerance[3] = real(0);
+	tolerance[4] = real(1);
+	tolerance[5] = real(2);
 
-	return true;
+	return proceed();
 }
 
-bool Database::saveModel(const QString& file_name) {
-	QFile file(file_name);
-	file.open(QIODevice::WriteOnly);
+bool Database::saveModel(const QString& file_name, const Progress& progress) {
+	FMC_ALLOCATION_SCOPE("save");
+
+	// written to a temporary file which only replaces the target on commit
+	QSaveFile file(file_name);
+	if(!file.open(QIODevice::WriteOnly)) return false;
 	QTextStream output(&file);
 
+	auto section = 0;
+	auto proceed = [&]() {
+		if(!progress || progress(++section)) return true;
+		file.cancelWriting();
+		return false;
+	};
+
 	output.setRealNumberNotation(QTextStream::ScientificNotation);
 	output.setRealNumberPrecision(4);
 
@@ -373,12 +541,12 @@ bool Database::saveModel(const QString& file_name) {
 
 	compress();
 
-	output << node_pool.size() << ' ';
+	output << node_pool->size() << ' ';
 
 	auto frame_size = 0;
 	auto brace_size = 0;
 	auto wall_size = 0;
-	for(auto& [fst, snd] : element_pool) {
+	for(auto& [fst, snd] : *element_pool) {
 		if(snd.type == Element::Type::Frame) frame_size++;
 		else if(snd.type == Element::Type::Brace) brace_size++;
 		else if(snd.type == Element::Type::Wall) wall_size++;
@@ -387,17 +555,23 @@ bool Database::saveModel(const QString& file_name) {
 	output << brace_size << ' ';
 	output << wall_size << ' ';
 
-	output << frame_section_pool.size() << ' ';
-	output << wall_section_pool.size() << '\n';
+	output << frame_section_pool->size() << ' ';
+	output << wall_section_pool->size() << '\n';
+
+	if(!proceed()) return false;
 
 	output << '\n';
 
 	serialize<Node>(output);
+	if(!proceed()) return false;
 	serialize<FrameSection>(output);
 	serialize<WallSection>(output);
+	if(!proceed()) return false;
 	serialize<Element>(output);
+	if(!proceed()) return false;
 
 	serializeMass(output);
+	if(!proceed()) return false;
 	serializeBC(output);
 
 	output << tolerance.at(0) << ' ';
@@ -407,16 +581,18 @@ bool Database::saveModel(const QString& file_name) {
 	output << tolerance.at(4) << ' ';
 	output << tolerance.at(5) << '\n';
 
-	return true;
+	output.flush();
+
+	return proceed() && file.commit();
 }
 
 void Database::serializeMass(QTextStream& output) {
 	auto counter = 0;
-	for(auto& [fst, snd] : node_pool) if(snd.mass > 0.) ++counter;
+	for(auto& [fst, snd] : *node_pool) if(snd.mass > 0.) ++counter;
 
 	output << counter << " ! TOTAL NUMBER OF NODES APPILED WITH MASS\n";
 
-	auto t_node = node_pool.cbegin();
+	auto t_node = node_pool->cbegin();
 	for(auto I = 1; I <= counter; ++I) {
 		while(t_node->second.mass <= 0.) ++t_node;
 		output << I << ' ' << t_node->first << ' ' << t_node->second.mass << '\n';
@@ -428,7 +604,7 @@ void Database::serializeMass(QTextStream& output) {
 
 void Database::serializeBC(QTextStream& output) {
 	auto counter = 0;
-	for(auto& [fst, snd] : node_pool)
+	for(auto& [fst, snd] : *node_pool)
 		for(auto& I : snd.fixity)
 			if(I) {
 				++counter;
@@ -439,11 +615,11 @@ void Database::serializeBC(QTextStream& output) {
 
 	QVector<int> bc_list;
 
-	auto t_node = node_pool.cbegin();
+	auto t_node = node_pool->cbegin();
 	for(auto I = 1; I <= counter; ++I) {
 		long long t_num;
 		while(true) {
-			t_num = t_node->second.fixity.count(true);
+			t_num = std::count(t_node->second.fixity.cbegin(), t_node->second.fixity.cend(), true);
 			if(t_num != 0) break;
 			++t_node;
 		}
@@ -482,11 +658,12 @@ void Database::compress() {
 void Database::compress_node(const int old_tag, const int new_tag) {
 	if(old_tag == new_tag) return;
 
-	auto t_node = node_pool.extract(old_tag);
+	auto& t_pool = node_pool.write();
+	auto t_node = t_pool.extract(old_tag);
 	t_node.key() = new_tag;
-	node_pool.insert(std::move(t_node));
+	t_pool.insert(std::move(t_node));
 
-	for(auto& [fst, snd] : element_pool) {
+	for(auto& [fst, snd] : element_pool.write()) {
 		if(snd.encoding.at(0) == old_tag) snd.encoding[0] = new_tag;
 		if(snd.encoding.at(1) == old_tag) snd.encoding[1] = new_tag;
 	}
@@ -495,11 +672,12 @@ void Database::compress_node(const int old_tag, const int new_tag) {
 void Database::compress_wall_section(const int old_tag, const int new_tag) {
 	if(old_tag == new_tag) return;
 
-	auto t_section = wall_section_pool.extract(old_tag);
+	auto& t_pool = wall_section_pool.write();
+	auto t_section = t_pool.extract(old_tag);
 	t_section.key() = new_tag;
-	wall_section_pool.insert(std::move(t_section));
+	t_pool.insert(std::move(t_section));
 
-	for(auto& [fst, snd] : element_pool) {
+	for(auto& [fst, snd] : element_pool.write()) {
 		if(snd.type != Element::Type::Wall) continue;
 		if(snd.section_tag == old_tag) snd.section_tag = new_tag;
 	}
@@ -508,100 +686,112 @@ void Database::compress_wall_section(const int old_tag, const int new_tag) {
 void Database::compress_frame_section(const int old_tag, const int new_tag) {
 	if(old_tag == new_tag) return;
 
-	auto t_section = frame_section_pool.extract(old_tag);
+	auto& t_pool = frame_section_pool.write();
+	auto t_section = t_pool.extract(old_tag);
 	t_section.key() = new_tag;
-	frame_section_pool.insert(std::move(t_section));
+	t_pool.insert(std::move(t_section));
 
-	for(auto& [fst, snd] : element_pool) {
+	for(auto& [fst, snd] : element_pool.write()) {
 		if(snd.type == Element::Type::Wall) continue;
 		if(snd.section_tag == old_tag) snd.section_tag = new_tag;
 	}
 }
 
-QString Database::remove_comment(QString in) {
-	in.replace(QString("\t"), QString(" "));
-	in.replace(QString(","), QString(" "));
-	in.remove(QRegularExpression("!.*$"));
-	return in;
+void Database::tokenize(const QString& line, std::pmr::vector<QStringView>& pool) {
+	pool.clear();
+
+	// spaces, tabs and commas separate tokens, anything after '!' is a comment
+	const auto* data = line.constData();
+	auto start = 0;
+	for(auto I = 0; I <= line.size(); ++I) {
+		const auto end = I == line.size() || data[I] == QLatin1Char('!');
+		if(end || data[I] == QLatin1Char(' ') || data[I] == QLatin1Char('\t') || data[I] == QLatin1Char(',')) {
+			if(I > start) pool.emplace_back(data + start, I - start);
+			if(end) return;
+			start = I + 1;
+		}
+	}
 }
 
 template<typename T> void Database::highlight(int, bool) { throw; }
 
+// highlighting only touches the selection, the pools and their revision are left alone
+// the selection box grows here and goes stale when a node or element on its surface leaves
 template<> void Database::highlight<Database::Node>(const int tag, const bool highlighted) {
-	const auto t_node = node_pool.find(tag);
-	if(t_node == node_pool.end()) return;
-	t_node->second.highlighted = highlighted;
+	if(highlighted == (node_selection->count(tag) != 0)) return;
+
+	const auto t_node = node_pool->find(tag);
+	if(!highlighted) {
+		node_selection.write().erase(tag);
+		if(t_node == node_pool->end()) selection_stale = true;
+		else touchSelection(t_node->second.position);
+	} else if(t_node != node_pool->end()) {
+		node_selection.write().insert(tag);
+		selection_bounds.expand(t_node->second.position);
+	}
 }
 
 template<> void Database::highlight<Database::Element>(const int tag, const bool highlighted) {
-	const auto t_element = element_pool.find(tag);
-	if(t_element == element_pool.end()) return;
-	t_element->second.highlighted = highlighted;
+	if(highlighted == (element_selection->count(tag) != 0)) return;
+
+	const auto t_element = element_pool->find(tag);
+	if(!highlighted) {
+		element_selection.write().erase(tag);
+		if(t_element == element_pool->end()) selection_stale = true;
+		else for(const auto I : t_element->second.encoding) touchSelection(node_pool->at(I).position);
+	} else if(t_element != element_pool->end()) {
+		element_selection.write().insert(tag);
+		for(const auto I : t_element->second.encoding) selection_bounds.expand(node_pool->at(I).position);
+	}
 }
 
+template<typename T> const std::unordered_set<int>& Database::getHighlighted() const { throw; }
+
+template<> const std::unordered_set<int>& Database::getHighlighted<Database::Node>() const { return *node_selection; }
+
+template<> const std::unordered_set<int>& Database::getHighlighted<Database::Element>() const { return *element_selection; }
+
 template<typename T> bool Database::add(int, T&&) { throw; }
 
-template<> bool Database::add<Database::Node>(const int tag, Node&& obj) { return node_pool.try_emplace(tag, std::forward<Node>(obj)).second; }
+template<> bool Database::add<Database::Node>(const int tag, Node&& obj) {
+	const auto position = obj.position;
+	if(!node_pool.write().try_emplace(tag, std::forward<Node>(obj)).second) return false;
+	bounds.expand(position);
+	return true;
+}
 
-template<> bool Database::add<Database::WallSection>(const int tag, WallSection&& obj) { return wall_section_pool.try_emplace(tag, std::forward<WallSection>(obj)).second; }
+template<> bool Database::add<Database::WallSection>(const int tag, WallSection&& obj) { return wall_section_pool.write().try_emplace(tag, std::forward<WallSection>(obj)).second; }
 
-template<> bool Database::add<Database::FrameSection>(const int tag, FrameSection&& obj) { return frame_section_pool.try_emplace(tag, std::forward<FrameSection>(obj)).second; }
+template<> bool Database::add<Database::FrameSection>(const int tag, FrameSection&& obj) { return frame_section_pool.write().try_emplace(tag, std::forward<FrameSection>(obj)).second; }
 
 template<> bool Database::add<Database::Element>(const int tag, Element&& obj) {
-	for(auto& I : obj.encoding) if(node_pool.find(I) == node_pool.end()) return false;
+	for(auto& I : obj.encoding) if(node_pool->find(I) == node_pool->end()) return false;
 
-	return element_pool.try_emplace(tag, std::forward<Element>(obj)).second;
+	return element_pool.write().try_emplace(tag, std::forward<Element>(obj)).second;
 }
 
-template<typename T> T& Database::get(int) { throw; }
+template<typename T> const T& Database::get(int) const { throw; }
 
-template<> Database::Node& Database::get<Database::Node>(const int tag) { return node_pool.at(tag); }
+template<> const Database::Node& Database::get<Database::Node>(const int tag) const { return node_pool->at(tag); }
 
-template<> Database::WallSection& Database::get<Database::WallSection>(const int tag) { return wall_section_pool.at(tag); }
+template<> const Database::WallSection& Database::get<Database::WallSection>(const int tag) const { return wall_section_pool->at(tag); }
 
-template<> Database::FrameSection& Database::get<Database::FrameSection>(const int tag) { return frame_section_pool.at(tag); }
+template<> const Database::FrameSection& Database::get<Database::FrameSection>(const int tag) const { return frame_section_pool->at(tag); }
 
-template<> Database::Element& Database::get<Database::Element>(const int tag) { return element_pool.at(tag); }
+template<> const Database::Element& Database::get<Database::Element>(const int tag) const { return element_pool->at(tag); }
 
 template<typename T> void Database::serialize(QTextStream&) { throw; }
 
 template<> void Database::serialize<Database::Node>(QTextStream& output) {
 	output << "! NODE\n";
-	for(auto& I : getNodeTag()) {
-		output << I << ' ';
-		auto& snd = node_pool.at(I);
-		output << snd.x() << ' ';
-		output << snd.y() << ' ';
-		output << snd.z() << '\n';
-	}
+	for(auto& I : getNodeTag()) Schema::write(output, I, node_pool->at(I));
 	output << "\n\n";
 }
 
 template<> void Database::serialize<Database::WallSection>(QTextStream& output) {
 	output << "! WALL DATA\n";
 
-	for(auto& I : getWallSectionTag()) {
-		output << "! NUMBER " << I << '\n';
-		auto& snd = wall_section_pool.at(I);
-		output << snd.parameter.at(0) << ' ';
-		output << snd.parameter.at(1) << ' ';
-		output << snd.parameter.at(2) << ' ';
-		output << snd.parameter.at(3) << ' ';
-		output << snd.parameter.at(4) << ' ';
-		output << snd.parameter.at(5) << '\n';
-		output << snd.parameter.at(6) << ' ';
-		output << snd.parameter.at(7) << ' ';
-		output << snd.parameter.at(8) << ' ';
-		output << snd.parameter.at(9) << ' ';
-		output << snd.parameter.at(10) << ' ';
-		output << snd.parameter.at(11) << '\n';
-		output << snd.parameter.at(12) << ' ';
-		output << snd.parameter.at(13) << ' ';
-		output << snd.parameter.at(14) << ' ';
-		output << snd.parameter.at(15) << ' ';
-		output << snd.parameter.at(16) << ' ';
-		output << snd.parameter.at(17) << "\n\n";
-	}
+	for(auto& I : getWallSectionTag()) Schema::write(output, I, wall_section_pool->at(I));
 
 	output << '\n';
 }
@@ -609,15 +799,7 @@ template<> void Database::serialize<Database::WallSection>(QTextStream& output)
 template<> void Database::serialize<Database::FrameSection>(QTextStream& output) {
 	output << "! FRAME MEMBER TYPE\n";
 
-	for(auto& I : getFrameSectionTag()) {
-		output << "! NUMBER " << I << '\n';
-		auto& snd = frame_section_pool.at(I);
-		output << static_cast<int>(snd.type) + 1 << ' ';
-		output << snd.parameter.at(0) << ' ';
-		output << snd.parameter.at(1) << ' ';
-		output << snd.parameter.at(2) << ' ';
-		output << snd.parameter.at(3) << '\n';
-	}
+	for(auto& I : getFrameSectionTag()) Schema::write(output, I, frame_section_pool->at(I));
 
 	output << "\n\n";
 }
@@ -625,37 +807,25 @@ template<> void Database::serialize<Database::FrameSection>(QTextStream& output)
 template<> void Database::serialize<Database::Element>(QTextStream& output) {
 	output << "! FRAME ELEMENT\n";
 	for(auto& I : getElementTag()) {
-		auto& snd = element_pool.at(I);
-		if(snd.type != Element::Type::Frame) continue;
-		output << I << " 1 ";
-		output << snd.encoding.at(0) << ' ';
-		output << snd.encoding.at(1) << ' ';
-		output << snd.section_tag << '\n';
+		auto& snd = element_pool->at(I);
+		if(snd.type == Element::Type::Frame) Schema::write<Element, Element::Type::Frame>(output, I, snd);
 	}
 	output << "\n\n! BRACE ELEMENT\n";
 	for(auto& I : getElementTag()) {
-		auto& snd = element_pool.at(I);
-		if(snd.type != Element::Type::Brace) continue;
-		output << I << " 2 ";
-		output << snd.encoding.at(0) << ' ';
-		output << snd.encoding.at(1) << ' ';
-		output << snd.section_tag << '\n';
+		auto& snd = element_pool->at(I);
+		if(snd.type == Element::Type::Brace) Schema::write<Element, Element::Type::Brace>(output, I, snd);
 	}
 	output << "\n\n! WALL ELEMENT\n";
 	for(auto& I : getElementTag()) {
-		auto& snd = element_pool.at(I);
-		if(snd.type != Element::Type::Wall) continue;
-		output << I << ' ';
-		output << snd.encoding.at(0) << ' ';
-		output << snd.encoding.at(1) << ' ';
-		output << snd.section_tag << ' ' << snd.orient << '\n';
+		auto& snd = element_pool->at(I);
+		if(snd.type == Element::Type::Wall) Schema::write<Element, Element::Type::Wall>(output, I, snd);
 	}
 	output << "\n\n";
 }
 
-Database::Element::Element(const int st, QVector<int> e, const QString& t, const int o)
+Database::Element::Element(const int st, const std::array<int, 2> e, const QString& t, const int o)
 	: section_tag(st)
-	, encoding(std::forward<QVector<int>>(e))
+	, encoding(e)
 	, orient(o) {
 	if(t == "Wall") type = Type::Wall;
 	else if(t == "Brace") type = Type::Brace;
@@ -18,19 +18,27 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <QStringView>
 #include <QTextStream>
 #include <QVector3D>
 #include <QVector>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <unordered_set>
 
 class Database {
 public:
 	struct Node {
 		QVector3D position = QVector3D(0, 0, 0);
-		QVector<bool> fixity = QVector<bool>(6, false);
-		QVector<double> load = QVector<double>(6, 0.);
-		QVector<double> displacement = QVector<double>(6, 0.);
+		std::array<bool, 6> fixity{};
+		std::array<double, 6> load{};
+		std::array<double, 6> displacement{};
 		double mass = 0.;
-		bool highlighted = false;
 
 		[[nodiscard]] float x() const { return position.x(); }
 
@@ -62,15 +70,32 @@ public:
 			Frame
 		};
 
-		explicit Element(int = 0, QVector<int>  = QVector<int>(), const QString& = "Frame", int = 1);
+		explicit Element(int = 0, std::array<int, 2> = {}, const QString& = "Frame", int = 1);
 
 		int section_tag = 0;
-		QVector<int> encoding = QVector<int>();
+		std::array<int, 2> encoding{};
 		Type type = Type::Frame;
 		int orient = 1;
-		bool highlighted = false;
 	};
 
+	// axis aligned box around a set of nodes
+	struct Bounds {
+		QVector3D lower = QVector3D(0, 0, 0);
+		QVector3D upper = QVector3D(0, 0, 0);
+		bool empty = true;
+
+		void expand(const QVector3D&);
+		[[nodiscard]] bool touches(const QVector3D&) const;
+		[[nodiscard]] QVector3D centre() const;
+		[[nodiscard]] float radius() const;
+	};
+
+	// Kept up to date by every change, so reading it is free.
+	[[nodiscard]] const Bounds& getBounds() const;
+	// Highlighted nodes and the nodes of highlighted elements.
+	// Grown as the selection grows, rebuilt here only after a node on its surface has moved or left the selection.
+	[[nodiscard]] const Bounds& getSelectionBounds();
+
 	[[nodiscard]] const std::unordered_map<int, Node>& getNodePool() const;
 	[[nodiscard]] const std::unordered_map<int, WallSection>& getWallSectionPool() const;
 	[[nodiscard]] const std::unordered_map<int, FrameSection>& getFrameSectionPool() const;
@@ -88,7 +113,8 @@ public:
 
 	template<typename T> bool add(int, T&&);
 	template<typename T> void highlight(int, bool);
-	template<typename T> T& get(int);
+	template<typename T> [[nodiscard]] const std::unordered_set<int>& getHighlighted() const;
+	template<typename T> const T& get(int) const;
 
 	bool removeNode(int);
 	bool removeWallSection(int);
@@ -96,10 +122,15 @@ public:
 	bool removeElement(int);
 
 	void changePosition(int, QVector3D&&);
-	void changeFixity(int, QVector<bool>&&);
-	void changeLoad(int, QVector<double>&&);
+	void changeFixity(int, std::array<bool, 6>&&);
+	void changeLoad(int, std::array<double, 6>&&);
 	void changeMass(int, double);
-	void changeDisplacement(int, QVector<double>&&);
+	void changeDisplacement(int, std::array<double, 6>&&);
+	// Same change for every node, the pool is written once rather than once per node.
+	void clearFixity();
+	void clearLoad();
+	void clearMass();
+	void clearDisplacement();
 	void changeSection(int, int);
 	void splitElement(int, int);
 	void removeElement();
@@ -111,8 +142,24 @@ public:
 	void changeAccxRecord(const QString&);
 	void changeAccyRecord(const QString&);
 
-	bool loadModel(const QString&);
-	bool saveModel(const QString&);
+	// Cheap read-only copy for background work, take it on the thread that owns the model.
+	// Pools are shared until the next change, which copies only the pool being changed.
+	// A pool is released when the last snapshot holding it goes away.
+	// Release snapshots on the owning thread too, a change decides from the use count whether it may write in place.
+	[[nodiscard]] std::shared_ptr<const Database> snapshot() const;
+
+	// Changes whenever any pool is changed, never repeats within a session.
+	[[nodiscard]] std::uint64_t getRevision() const;
+	// Same for the highlighted nodes and elements, which are kept apart from the pools.
+	[[nodiscard]] std::uint64_t getSelectionRevision() const;
+
+	// Called after each section of a model file with the number of sections done.
+	// Returning false cancels the load or save.
+	using Progress = std::function<bool(int)>;
+	static constexpr int sections = 6;
+
+	bool loadModel(const QString&, const Progress& = {});
+	bool saveModel(const QString&, const Progress& = {});
 
 	template<typename T> void serialize(QTextStream&);
 
@@ -132,23 +179,69 @@ public:
 	QVector<double> tolerance = QVector<double>(6, 1E-3);
 
 protected:
-	std::unordered_map<int, Node> node_pool;
-	std::unordered_map<int, WallSection> wall_section_pool;
-	std::unordered_map<int, FrameSection> frame_section_pool;
-	std::unordered_map<int, Element> element_pool;
+	// copy-on-write storage, reads go through -> and changes through write()
+	// copies may be read on other threads, but only the thread holding a copy may change it
+	// copies are best let go on the thread that made them, the fence in write() keeps a release elsewhere safe
+	template<typename T> class Shared {
+		std::shared_ptr<T> data = std::make_shared<T>();
+		std::uint64_t revision = nextRevision();
+
+	public:
+		const T& operator*() const { return *data; }
+
+		const T* operator->() const { return data.get(); }
+
+		[[nodiscard]] std::uint64_t getRevision() const { return revision; }
+
+		T& write() {
+			revision = nextRevision();
+			if(data.use_count() > 1) data = std::make_shared<T>(*data);
+			// the count is read relaxed, the fence orders the writes after the release of the last other reference
+			else std::atomic_thread_fence(std::memory_order_acquire);
+			return *data;
+		}
+	};
+
+	static std::uint64_t nextRevision();
+
+	Shared<std::unordered_map<int, Node>> node_pool;
+	Shared<std::unordered_map<int, WallSection>> wall_section_pool;
+	Shared<std::unordered_map<int, FrameSection>> frame_section_pool;
+	Shared<std::unordered_map<int, Element>> element_pool;
+
+	Shared<std::unordered_set<int>> node_selection;
+	Shared<std::unordered_set<int>> element_selection;
+
+	// grows with new nodes, rebuilt only when a node on its surface moves or goes away
+	Bounds bounds;
+
+	// grows with highlighted nodes and elements, marked stale when one on its surface moves or leaves the selection
+	Bounds selection_bounds;
+	bool selection_stale = false;
+
+	void updateBounds();
+	void touchSelection(const QVector3D&);
+
+	// removed tags leave the selection, as they are given out again to new nodes and elements
+	// returns whether the tag was selected
+	static bool deselect(Shared<std::unordered_set<int>>&, int);
 
 	void compress();
 	void compress_node(int, int);
 	void compress_wall_section(int, int);
 	void compress_frame_section(int, int);
 
-	static QString remove_comment(QString);
+	static void tokenize(const QString&, std::pmr::vector<QStringView>&);
 };
 
 template<> bool Database::add<Database::Node>(int, Node&&);
 template<> bool Database::add<Database::WallSection>(int, WallSection&&);
 template<> bool Database::add<Database::FrameSection>(int, FrameSection&&);
 template<> bool Database::add<Database::Element>(int, Element&&);
+template<> void Database::highlight<Database::Node>(int, bool);
+template<> void Database::highlight<Database::Element>(int, bool);
+template<> const std::unordered_set<int>& Database::getHighlighted<Database::Node>() const;
+template<> const std::unordered_set<int>& Database::getHighlighted<Database::Element>() const;
 template<> void Database::serialize<Database::Node>(QTextStream&);
 template<> void Database::serialize<Database::WallSection>(QTextStream&);
 template<> void Database::serialize<Database::FrameSection>(QTextStream&);
@@ -1,4 +1,4 @@
-QT       += core gui opengl svg
+QT       += core gui opengl svg concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -14,7 +14,15 @@ RC_ICONS = ../res/UC.ico
 
 DEFINES += NDEBUG
 
+# Count heap allocations per load, save, frame and UI action, results are printed to stderr.
+#DEFINES += FMC_TRACK_ALLOCATION
+# Also print every scope as it ends, which is one line per frame.
+#DEFINES += FMC_TRACK_ALLOCATION_SCOPE
+
 SOURCES += \
+    AllocationTracker.cpp \
+    BatchRenderer.cpp \
+    ClusterTree.cpp \
     Database.cpp \
     Knock.cpp \
     ModelRenderer.cpp \
@@ -22,10 +30,14 @@ SOURCES += \
     PlotSetting.cpp
 
 HEADERS += \
+    AllocationTracker.h \
+    BatchRenderer.h \
+    ClusterTree.h \
     Database.h \
     ModelBuilder.h \
     ModelRenderer.h \
-    PlotSetting.h
+    PlotSetting.h \
+    Schema.h
 
 FORMS += \
     ModelBuilder.ui
@@ -17,20 +17,97 @@
 
 #include "ModelBuilder.h"
 
+#include <AllocationTracker.h>
+#include <BatchRenderer.h>
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
 #include <QScreen>
 #include <QSettings>
 #include <QStyleFactory>
 #include <QSurfaceFormat>
+#include <QTimer>
+#include <cstdio>
 
 bool FMC_DARK = false;
 
+#ifdef FMC_TRACK_ALLOCATION
+class Application final : public QApplication {
+public:
+	using QApplication::QApplication;
+
+	bool notify(QObject* receiver, QEvent* event) override {
+		// attribute the work triggered by user input to a ui action
+		switch(event->type()) {
+		case QEvent::MouseButtonRelease:
+		case QEvent::KeyPress:
+		case QEvent::Shortcut: {
+			FMC_ALLOCATION_SCOPE("action");
+			return QApplication::notify(receiver, event);
+		}
+		default:
+			return QApplication::notify(receiver, event);
+		}
+	}
+};
+#else
+using Application = QApplication;
+#endif
+
 int main(int argc, char* argv[]) {
-	QApplication app(argc, argv);
+	QElapsedTimer startup;
+	startup.start();
+
+	// the default format must be in place before any gl widget is created
+	QSurfaceFormat format;
+	format.setDepthBufferSize(24);
+	format.setStencilBufferSize(8);
+	// core profile, vertex arrays, instancing and uniform buffers are all part of it
+	format.setVersion(3, 3);
+	format.setProfile(QSurfaceFormat::CoreProfile);
+	// lines wider than a pixel are deprecated, most drivers still draw them outside forward compatible contexts
+	format.setOption(QSurfaceFormat::DeprecatedFunctions);
+	// frames are paced by the display, the canvas asks for the next one when the last is swapped
+	format.setSwapInterval(1);
+	QSurfaceFormat::setDefaultFormat(format);
+
+	Application app(argc, argv);
 	QApplication::setApplicationName("Frame Model Creator");
 	QApplication::setApplicationDisplayName("Frame Model Creator");
 	QApplication::setOrganizationName("University of Canterbury");
-    QApplication::setWindowIcon(QIcon(":/../res/UC.ico"));
+
+	QCommandLineParser parser;
+	// --startup-time prints the time spent in each startup stage and quits after the first frame
+	parser.addOption({"startup-time", "Print the time spent in each startup stage and quit after the first frame."});
+	// --batch renders every model given from each view into the directory and quits without opening a window
+	parser.addOption({"batch", "Render the models given into <directory> without opening a window.", "directory"});
+	parser.addOption({"views", "Views to render in batch, any of plan, front, side and iso.", "list", "plan,front,side,iso"});
+	parser.addOption({"size", "Size of the images rendered in batch.", "WxH", "1600x1200"});
+	parser.addPositionalArgument("models", "Model files to render in batch.", "[models...]");
+	// options of Qt itself are left to Qt
+	parser.parse(QApplication::arguments());
+
+	const auto measure = parser.isSet("startup-time");
+	auto report = [&](const char* stage) { if(measure) std::fprintf(stderr, "[startup] %s: %lld ms\n", stage, startup.elapsed()); };
+
+	report("application");
+
+	if(parser.isSet("batch")) {
+		const auto extent = parser.value("size").split('x');
+		const auto size = extent.size() == 2 ? QSize(extent.at(0).toInt(), extent.at(1).toInt()) : QSize();
+		if(size.isEmpty()) {
+			std::fprintf(stderr, "[batch] size %s is not WxH\n", qUtf8Printable(parser.value("size")));
+			return 1;
+		}
+
+		const auto models = parser.positionalArguments();
+		const auto views = parser.value("views").split(',', Qt::SkipEmptyParts);
+
+		BatchRenderer batch(size, parser.value("batch"));
+		const auto written = batch.run(models, views);
+		std::fprintf(stderr, "[batch] %d images written\n", written);
+		return written == models.size() * views.size() ? 0 : 1;
+	}
 
 	auto font = QApplication::font();
 	const auto rec = QGuiApplication::primaryScreen()->availableGeometry();
@@ -72,17 +149,25 @@ int main(int argc, char* argv[]) {
 	}
 #endif
 
+	report("style");
+
 	ModelBuilder win;
 	win.setWindowTitle("Frame Model Creator");
 
-	QSurfaceFormat format;
-	format.setDepthBufferSize(24);
-	format.setStencilBufferSize(8);
-	format.setVersion(2, 0);
-	format.setProfile(QSurfaceFormat::CompatibilityProfile);
-	QSurfaceFormat::setDefaultFormat(format);
+	report("window");
+
+	if(measure)
+		QObject::connect(&win, &ModelBuilder::frameSwapped, [&] {
+			report("first frame");
+			QApplication::quit();
+		});
 
 	win.show();
 
+	report("show");
+
+	// decoding the multi-size icon is not needed for the first frame
+	QTimer::singleShot(0, [] { QApplication::setWindowIcon(QIcon(":/../res/UC.ico")); });
+
 	return QApplication::exec();
 }
@@ -16,8 +16,16 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "ModelBuilder.h"
+#include <QCloseEvent>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QInputDialog>
+#include <QProgressDialog>
 #include <QSvgRenderer>
 #include <QSvgWidget>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
 #include "ui_ModelBuilder.h"
 
 ModelBuilder::ModelBuilder(QWidget* parent)
@@ -26,6 +34,12 @@ ModelBuilder::ModelBuilder(QWidget* parent)
 	ui->setupUi(this);
 
 	ui->canvas->setModel(&model);
+
+	connect(ui->canvas, &ModelRenderer::frameSwapped, this, &ModelBuilder::frameSwapped);
+	connect(ui->canvas, &ModelRenderer::nodePicked, this, &ModelBuilder::pickNode);
+	connect(ui->canvas, &ModelRenderer::elementPicked, this, &ModelBuilder::pickElement);
+	connect(ui->canvas, &ModelRenderer::regionSelected, this, &ModelBuilder::selectRegion);
+	connect(ui->canvas, &ModelRenderer::framesDropped, this, [this](const int dropped, const int total) { ui->statusBar->showMessage(tr("%1 of %2 frames dropped while navigating").arg(dropped).arg(total), 5000); });
 }
 
 ModelBuilder::~ModelBuilder() { delete ui; }
@@ -41,7 +55,7 @@ void ModelBuilder::highlightNode(const QString& text, const int index) {
 		highlighted_node[index] = tag;
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::highlightNodeA(QString text) {
@@ -106,7 +120,7 @@ void ModelBuilder::highlightNodeE() {
 		}
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::highlightElement(const QString& text, const int index) {
@@ -120,18 +134,116 @@ void ModelBuilder::highlightElement(const QString& text, const int index) {
 		highlighted_element[index] = tag;
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::highlightElementA(QString text) { highlightElement(text, 0); }
 
+// a picked entity goes into the box of the current tab, which highlights it as if chosen there
+void ModelBuilder::pickNode(const int tag) {
+	auto* target = ui->box_node;
+
+	if(ui->tab_main->currentWidget() == ui->tab_element) {
+		target = pick_second_end ? ui->box_node_j : ui->box_node_i;
+		pick_second_end = !pick_second_end;
+	} else if(ui->tab_main->currentWidget() == ui->tab_bc) target = ui->box_node_load;
+
+	target->setCurrentText(QString::number(tag));
+}
+
+void ModelBuilder::pickElement(const int tag) { ui->box_element->setCurrentText(QString::number(tag)); }
+
+// a region dragged on the canvas replaces the group, as the range and coordinate filters do
+void ModelBuilder::selectRegion(const QVector<int>& node, const QVector<int>& element) {
+	for(const auto& I : highlighted_group) model.highlight<Database::Node>(I, false);
+	for(const auto& I : highlighted_element_group) model.highlight<Database::Element>(I, false);
+
+	highlighted_group = node;
+	highlighted_element_group = element;
+
+	for(const auto& I : highlighted_group) model.highlight<Database::Node>(I, true);
+	for(const auto& I : highlighted_element_group) model.highlight<Database::Element>(I, true);
+
+	ui->canvas->update();
+}
+
+void ModelBuilder::runModelJob(const QString& label, std::function<bool(const Database::Progress&)>&& job, std::function<void(bool, bool)>&& done, const Qt::WindowModality modality) {
+	busy = true;
+
+	auto* dialog = new QProgressDialog(label, tr("Cancel"), 0, Database::sections, this);
+	dialog->setWindowModality(modality);
+	dialog->setMinimumDuration(500);
+
+	auto cancelled = std::make_shared<std::atomic_bool>(false);
+	connect(dialog, &QProgressDialog::canceled, [cancelled] { *cancelled = true; });
+
+	// the worker only reports through the future, which the watcher turns into updates on this thread
+	QFutureInterface<bool> future;
+	future.setProgressRange(0, Database::sections);
+	future.reportStarted();
+
+	auto* watcher = new QFutureWatcher<bool>(dialog);
+	connect(watcher, &QFutureWatcher<bool>::progressValueChanged, dialog, &QProgressDialog::setValue);
+	connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, dialog, cancelled, done = std::move(done)] {
+		busy = false;
+		done(watcher->result(), *cancelled);
+		dialog->deleteLater();
+		if(close_pending) close();
+	});
+	watcher->setFuture(future.future());
+
+	QThreadPool::globalInstance()->start([future, job = std::move(job), cancelled]() mutable {
+		auto success = false;
+		try {
+			success = job([&future, cancelled](const int section) {
+				future.setProgressValue(section);
+				return !*cancelled;
+			});
+		}
+		catch(...) {}
+		future.reportResult(success);
+		future.reportFinished();
+	});
+}
+
+// a running job is never cut short, the window closes once it has reported back
+void ModelBuilder::closeEvent(QCloseEvent* event) {
+	if(!busy) {
+		QMainWindow::closeEvent(event);
+		return;
+	}
+
+	close_pending = true;
+	ui->statusBar->showMessage(tr("Closing once the current file is done."));
+	event->ignore();
+}
+
+bool ModelBuilder::checkIdle() const {
+	if(busy) ui->statusBar->showMessage(tr("Wait for the current file to be done."), 5000);
+	return !busy;
+}
+
 void ModelBuilder::writeOutput() {
+	if(!checkIdle()) return;
+
 	QFileDialog dialog(this);
 	dialog.setFileMode(QFileDialog::AnyFile);
 	dialog.setAcceptMode(QFileDialog::AcceptSave);
 	if(dialog.exec()) {
 		const auto filename = dialog.selectedFiles();
-		if(1 == filename.size()) model.saveModel(filename.at(0));
+		if(1 == filename.size()) {
+			const auto& path = filename.at(0);
+			// the session keeps editing while a copy of the current model is written, so the progress does not block the window
+			// saving renumbers the copy, which shares the pools of the model until then
+			// the copy is made here and held by the callback, which is run and destroyed on this thread once the job is done
+			// the worker only goes through a pointer, the shared pools it lets go of while renumbering are covered by the fence in write()
+			const auto copy = std::make_shared<Database>(model);
+			runModelJob(tr("Saving %1").arg(path), [target = copy.get(), path](const Database::Progress& progress) { return target->saveModel(path, progress); }, [this, path, copy](const bool success, const bool cancelled) {
+				if(success || cancelled) return;
+				QMessageBox msg(QMessageBox::Critical, tr("Error"), tr("Fail to save file %1.").arg(path), QMessageBox::Ok, this);
+				msg.exec();
+			}, Qt::NonModal);
+		}
 	}
 }
 
@@ -144,10 +256,37 @@ void ModelBuilder::saveScreenshot() {
 		if(1 == filename.size()) {
 			auto path = filename.at(0);
 			if(!path.endsWith(".png") && !path.endsWith(".PNG")) path.append(".png");
-			if(!ui->canvas->grabFramebuffer().save(path, "PNG")) {
-				QMessageBox msg(QMessageBox::Critical, tr("Error"), tr("Fail to save file."), QMessageBox::Ok, this);
+
+			// any width, the height follows the shape of the canvas
+			auto accepted = false;
+			const auto canvas_w = std::max(1, ui->canvas->width());
+			const auto width = QInputDialog::getInt(this, tr("Screenshot"), tr("Width in pixels:"), static_cast<int>(ui->canvas->devicePixelRatioF() * canvas_w), 16, 32768, 1, &accepted);
+			if(!accepted) return;
+			const auto height = std::max(1, static_cast<int>(static_cast<qint64>(width) * ui->canvas->height() / canvas_w));
+
+			auto image = ui->canvas->renderImage(QSize(width, height));
+			if(image.isNull()) {
+				QMessageBox msg(QMessageBox::Critical, tr("Error"), tr("Fail to render %1 by %2 pixels.").arg(width).arg(height), QMessageBox::Ok, this);
 				msg.exec();
+				return;
 			}
+
+			// compressing a large image takes a while, the window stays responsive meanwhile
+			ui->statusBar->showMessage(tr("Saving %1").arg(path));
+
+			auto* watcher = new QFutureWatcher<bool>(this);
+			connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, path] {
+				watcher->deleteLater();
+				if(watcher->result()) {
+					ui->statusBar->showMessage(tr("Saved %1").arg(path), 5000);
+					return;
+				}
+				ui->statusBar->clearMessage();
+				QMessageBox msg(QMessageBox::Critical, tr("Error"), tr("Fail to save file %1.").arg(path), QMessageBox::Ok, this);
+				msg.exec();
+			});
+
+			watcher->setFuture(QtConcurrent::run([image = std::move(image), path] { return image.save(path, "PNG"); }));
 		}
 	}
 }
@@ -200,19 +339,35 @@ void ModelBuilder::showAbout() {
 }
 
 void ModelBuilder::openFile() {
+	if(!checkIdle()) return;
+
 	QFileDialog dialog(this);
 	dialog.setFileMode(QFileDialog::AnyFile);
 	if(dialog.exec()) {
 		const auto filename = dialog.selectedFiles();
 		if(1 == filename.size()) {
-			try { model.loadModel(filename.at(0)); }
-			catch(...) {
-				QMessageBox msg(this);
-				msg.setText(tr("Fail to read file %1.\n").arg(filename.at(0)) + "Please make sure the input file is correct.\nOtherwise contact the authors.\n");
-				msg.exec();
-			}
+			const auto& path = filename.at(0);
+			// parsed into a fresh model which only replaces the current one when complete
+			auto loaded = std::make_shared<Database>();
+			runModelJob(tr("Loading %1").arg(path), [loaded, path](const Database::Progress& progress) { return loaded->loadModel(path, progress); }, [this, loaded, path](const bool success, const bool cancelled) {
+				if(success) swapModel(std::move(*loaded));
+				else if(!cancelled) {
+					QMessageBox msg(this);
+					msg.setText(tr("Fail to read file %1.\n").arg(path) + "Please make sure the input file is correct.\nOtherwise contact the authors.\n");
+					msg.exec();
+				}
+			});
 		}
 	}
+}
+
+void ModelBuilder::swapModel(Database&& loaded) {
+	model = std::move(loaded);
+
+	highlighted_node.fill(0);
+	highlighted_group.clear();
+	highlighted_element.fill(0);
+	highlighted_element_group.clear();
 
 	ui->input_node_tag->setText(QString::number(model.getNextNodeTag()));
 	ui->input_element_tag->setText(QString::number(model.getNextElementTag()));
@@ -223,7 +378,7 @@ void ModelBuilder::openFile() {
 	updateElementList();
 	updateAnalysisSetting();
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::updateNodeList() const {
@@ -242,7 +397,7 @@ void ModelBuilder::updateNodeList() const {
 		ui->box_node_load->addItem(QString::number(I));
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::updateElementList() const {
@@ -251,7 +406,7 @@ void ModelBuilder::updateElementList() const {
 
 	for(const auto& I : model.getElementTag()) ui->box_element->addItem(QString::number(I));
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::updateAnalysisSetting() const {
@@ -292,7 +447,7 @@ void ModelBuilder::updateWallSectionList() {
 		for(const auto& I : model.getWallSectionTag()) { ui->box_section->addItem(QString::number(I)); }
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::updateFrameSectionList() {
@@ -306,7 +461,7 @@ void ModelBuilder::updateFrameSectionList() {
 		for(const auto& I : model.getFrameSectionTag()) { ui->box_section->addItem(QString::number(I)); }
 	}
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_box_analysis_type_currentIndexChanged(const int index) { model.changeAnalysisType(index); }
@@ -414,6 +569,7 @@ void ModelBuilder::on_button_remove_element_clicked() {
 
 void ModelBuilder::on_button_remove_all_element_clicked() {
 	model.removeElement();
+	highlighted_element_group.clear();
 
 	ui->input_element_tag->setText("1");
 	updateElementList();
@@ -423,11 +579,15 @@ void ModelBuilder::on_button_modify_node_clicked() {
 	const auto index = ui->box_modify_type->currentIndex();
 	const auto tag = ui->box_node->currentText().toInt();
 
-	if(0 == index) { model.removeNode(tag); } else if(1 == index || 2 == index) { for(const auto& I : highlighted_group) model.removeNode(I); } else if(3 == index) {
+	if(0 == index) { model.removeNode(tag); } else if(1 == index || 2 == index) {
+		// the tags are given out again, so the group must not unhighlight the new nodes later
+		for(const auto& I : highlighted_group) model.removeNode(I);
+		highlighted_group.clear();
+	} else if(3 == index) {
 		const auto a = ui->input_modify_node_a->text().toFloat();
 		const auto b = ui->input_modify_node_b->text().toFloat();
 		const auto c = ui->input_modify_node_c->text().toFloat();
-		model.get<Database::Node>(tag).position = QVector3D{a, b, c};
+		model.changePosition(tag, QVector3D{a, b, c});
 	}
 
 	ui->input_modify_node_a->setText("");
@@ -464,27 +624,27 @@ void ModelBuilder::on_button_change_section_clicked() {
 
 	model.changeSection(tag, sec_tag);
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_button_clear_bc_clicked() {
-	for(auto& [fst, snd] : model.getNodePool()) model.changeFixity(fst, QVector<bool>(6, false));
+	model.clearFixity();
 
 	ui->box_node_load->setCurrentIndex(0);
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_button_clear_load_clicked() {
 	const auto type = ui->box_load_type->currentText();
 
-	if(type == "Mass") for(auto& [fst, snd] : model.getNodePool()) model.changeMass(fst, 0.);
-	else if(type == "Displacement") for(auto& [fst, snd] : model.getNodePool()) model.changeDisplacement(fst, QVector<double>(6, 0.));
-	else for(auto& [fst, snd] : model.getNodePool()) model.changeLoad(fst, QVector<double>(6, 0.));
+	if(type == "Mass") model.clearMass();
+	else if(type == "Displacement") model.clearDisplacement();
+	else model.clearLoad();
 
 	ui->box_node_load->setCurrentIndex(0);
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_button_add_bc_clicked() {
@@ -503,11 +663,11 @@ void ModelBuilder::on_button_add_bc_clicked() {
 	const auto ry = ui->box_ry->checkState() == Qt::Checked;
 	const auto rz = ui->box_rz->checkState() == Qt::Checked;
 
-	for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeFixity(tag + I * increx + J * increy + K * increz, QVector<bool>{x, y, z, rx, ry, rz});
+	for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeFixity(tag + I * increx + J * increy + K * increz, {x, y, z, rx, ry, rz});
 
 	ui->box_node_load->setCurrentIndex(0);
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_button_add_load_clicked() {
@@ -528,15 +688,18 @@ void ModelBuilder::on_button_add_load_clicked() {
 	const auto rz = ui->input_loadrz->text().toDouble();
 
 	if(type == "Mass") for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeMass(tag + I * increx + J * increy + K * increz, x);
-	else if(type == "Force") for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeLoad(tag + I * increx + J * increy + K * increz, QVector<double>{x, y, z, rx, ry, rz});
-	else if(type == "Displacement") for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeDisplacement(tag + I * increx + J * increy + K * increz, QVector<double>{x, y, z, rx, ry, rz});
+	else if(type == "Force") for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeLoad(tag + I * increx + J * increy + K * increz, {x, y, z, rx, ry, rz});
+	else if(type == "Displacement") for(auto I = 0; I < repeatx; ++I) for(auto J = 0; J < repeaty; ++J) for(auto K = 0; K < repeatz; ++K) model.changeDisplacement(tag + I * increx + J * increy + K * increz, {x, y, z, rx, ry, rz});
 
 	ui->box_node_load->setCurrentIndex(0);
 
-	ui->canvas->repaint();
+	ui->canvas->update();
 }
 
 void ModelBuilder::on_button_add_element_clicked() {
+	// the next picked node starts a new element
+	pick_second_end = false;
+
 	const auto tag = ui->input_element_tag->text().toInt();
 	const auto sec_tag = ui->box_section->currentText().toInt();
 	const auto nodei_tag = ui->box_node_i->currentText().toInt();
@@ -561,7 +724,7 @@ void ModelBuilder::on_button_add_element_clicked() {
 				const auto new_i = nodei_tag + I * increix + J * increiy + K * increiz;
 				const auto new_j = nodej_tag + I * increjx + J * increjy + K * increjz;
 
-				model.add(model.getNextElementTag(), Database::Element(sec_tag, QVector<int>{new_i, new_j}, type, orient));
+				model.add(model.getNextElementTag(), Database::Element(sec_tag, {new_i, new_j}, type, orient));
 			}
 
 	ui->input_element_tag->setText(QString::number(model.getNextElementTag()));
@@ -572,6 +735,9 @@ void ModelBuilder::on_button_add_element_clicked() {
 	ui->box_node_j->setCurrentIndex(0);
 }
 
+// coming back to the element tab starts again from the first end
+void ModelBuilder::on_tab_main_currentChanged(int) { pick_second_end = false; }
+
 void ModelBuilder::on_button_add_wall_section_clicked() {
 	const auto tag = ui->input_wall_section_tag->text().toInt();
 
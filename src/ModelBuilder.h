@@ -46,11 +46,21 @@ public slots:
 	void highlightElement(const QString&, int);
 	void highlightElementA(QString);
 
+	void pickNode(int);
+	void pickElement(int);
+	void selectRegion(const QVector<int>&, const QVector<int>&);
+
 	void showAbout();
 	void openFile();
 	void writeOutput();
 	void saveScreenshot();
 
+signals:
+	void frameSwapped();
+
+protected:
+	void closeEvent(QCloseEvent*) override;
+
 private slots:
 	void on_box_analysis_type_currentIndexChanged(int);
 	void on_box_element_currentTextChanged(const QString&);
@@ -93,6 +103,7 @@ private slots:
 	void on_input_scale_textChanged(const QString&);
 	void on_input_wall_section_tag_textChanged(const QString&) const;
 	void on_reset_model_clicked();
+	void on_tab_main_currentChanged(int);
 	void on_box_element_textHighlighted(const QString&);
 	void on_check_accx_clicked(bool);
 	void on_check_accy_clicked(bool);
@@ -106,6 +117,21 @@ private:
 	QVector<int> highlighted_node = QVector<int>(4, 0);
 	QVector<int> highlighted_group = QVector<int>();
 	QVector<int> highlighted_element = QVector<int>(1, 0);
+	QVector<int> highlighted_element_group = QVector<int>();
+
+	// on the element tab picked nodes fill the first and the second end in turn
+	bool pick_second_end = false;
+
+	// a load or save job is running
+	bool busy = false;
+	// the window was asked to close while a job was running
+	bool close_pending = false;
+
+	// reports on the status bar when a job is running
+	[[nodiscard]] bool checkIdle() const;
+
+	void runModelJob(const QString&, std::function<bool(const Database::Progress&)>&&, std::function<void(bool, bool)>&&, Qt::WindowModality = Qt::WindowModal);
+	void swapModel(Database&&);
 
 	void updateNodeList() const;
 	void updateFrameSectionList();
@@ -17,762 +17,1975 @@
 
 // ReSharper disable CppClangTidyBugproneNarrowingConversions
 #include "ModelRenderer.h"
+#include <AllocationTracker.h>
 #include <Database.h>
+#include <QApplication>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QScreen>
+#include <QtMath>
+#include <algorithm>
 #include <cmath>
 
-void ModelRenderer::renderLabel(QPainter& painter, const QVector3D& position, const QString& string) const {
-	const auto canvas_pos = current_trans * QVector4D(position.x(), position.y(), position.z(), 1.);
+namespace {
+	// glyph meshes along the x axis as triangle lists, first vertex of each in the shared buffer
+	// outlines are frames a fifth of the glyph wide, so they do not depend on the width of lines
+	constexpr GLint glyph_square = 0;
+	constexpr GLint glyph_square_frame = 6;
+	constexpr GLint glyph_diamond_frame = 30;
+	constexpr GLint glyph_arrow = 54;
+	constexpr GLint glyph_quad = 72;
+
+	constexpr GLfloat glyph_mesh_data[] = {
+		// square, both fixed
+		0, -1, -1, 0, 1, -1, 0, 1, 1, 0, -1, -1, 0, 1, 1, 0, -1, 1,
+		// square frame, translation fixed
+		0, -1, -1, 0, 1, -1, 0, .7, -.7, 0, -1, -1, 0, .7, -.7, 0, -.7, -.7, 0, 1, -1, 0, 1, 1, 0, .7, .7, 0, 1, -1, 0, .7, .7, 0, .7, -.7,
+		0, 1, 1, 0, -1, 1, 0, -.7, .7, 0, 1, 1, 0, -.7, .7, 0, .7, .7, 0, -1, 1, 0, -1, -1, 0, -.7, -.7, 0, -1, 1, 0, -.7, -.7, 0, -.7, .7,
+		// diamond frame, rotation fixed
+		0, -1, 0, 0, 0, 1, 0, 0, .7, 0, -1, 0, 0, 0, .7, 0, -.7, 0, 0, 0, 1, 0, 1, 0, 0, .7, 0, 0, 0, 1, 0, .7, 0, 0, 0, .7,
+		0, 1, 0, 0, 0, -1, 0, 0, -.7, 0, 1, 0, 0, 0, -.7, 0, .7, 0, 0, 0, -1, 0, -1, 0, 0, -.7, 0, 0, 0, -1, 0, -.7, 0, 0, 0, -.7,
+		// arrow pointing at the node, two crossed heads and two crossed shafts
+		0, 0, 0, 2, 1, 0, 2, -1, 0, 0, 0, 0, 2, 0, 1, 2, 0, -1,
+		2, -.15, 0, 6, -.15, 0, 6, .15, 0, 2, -.15, 0, 6, .15, 0, 2, .15, 0, 2, 0, -.15, 6, 0, -.15, 6, 0, .15, 2, 0, -.15, 6, 0, .15, 2, 0, .15,
+		// unit quad, one label character
+		0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0};
+
+	// box from 0 to 1 along x and from -0.5 to 0.5 across, position and outward normal of each vertex
+	// two counterclockwise triangles per face
+	constexpr GLint box_vertex = 36;
+	constexpr GLfloat box_mesh_data[] = {
+		// -x
+		0, -.5, .5, -1, 0, 0, 0, .5, .5, -1, 0, 0, 0, .5, -.5, -1, 0, 0, 0, -.5, .5, -1, 0, 0, 0, .5, -.5, -1, 0, 0, 0, -.5, -.5, -1, 0, 0,
+		// +x
+		1, -.5, -.5, 1, 0, 0, 1, .5, -.5, 1, 0, 0, 1, .5, .5, 1, 0, 0, 1, -.5, -.5, 1, 0, 0, 1, .5, .5, 1, 0, 0, 1, -.5, .5, 1, 0, 0,
+		// -y
+		1, -.5, -.5, 0, -1, 0, 1, -.5, .5, 0, -1, 0, 0, -.5, .5, 0, -1, 0, 1, -.5, -.5, 0, -1, 0, 0, -.5, .5, 0, -1, 0, 0, -.5, -.5, 0, -1, 0,
+		// +y
+		0, .5, -.5, 0, 1, 0, 0, .5, .5, 0, 1, 0, 1, .5, .5, 0, 1, 0, 0, .5, -.5, 0, 1, 0, 1, .5, .5, 0, 1, 0, 1, .5, -.5, 0, 1, 0,
+		// -z
+		0, .5, -.5, 0, 0, -1, 1, .5, -.5, 0, 0, -1, 1, -.5, -.5, 0, 0, -1, 0, .5, -.5, 0, 0, -1, 1, -.5, -.5, 0, 0, -1, 0, -.5, -.5, 0, 0, -1,
+		// +z
+		0, -.5, .5, 0, 0, 1, 1, -.5, .5, 0, 0, 1, 1, .5, .5, 0, 0, 1, 0, -.5, .5, 0, 0, 1, 1, .5, .5, 0, 0, 1, 0, .5, .5, 0, 0, 1};
+
+	// std140 layout of the Scene block, filled once per pass and bound to binding point zero
+	struct SceneBlock {
+		std::array<GLfloat, 16> trans_mat;
+		std::array<GLfloat, 4> hl_color;
+		GLfloat amplitude;
+		std::array<GLfloat, 3> padding;
+	};
+
+	constexpr GLuint scene_binding = 0;
 
-	const auto norm_z = canvas_pos.z() / canvas_pos.w();
+	// nodes projected at a time when selecting a region
+	constexpr int projection_batch = 16;
 
-	if(norm_z > 1.f || norm_z < -1.f) return;
+	// nodes drawn at most while the camera moves
+	constexpr GLuint node_budget = 16384;
 
-	painter.drawText((.5 + .5 * canvas_pos.x() / canvas_pos.w()) * width(), (.5 - .5 * canvas_pos.y() / canvas_pos.w()) * height(), string);
+	// largest offscreen target an exported image is drawn through, in pixels on each side
+	constexpr int export_tile = 2048;
+
+	// seconds for the smooth camera to cover most of the way to its target, and for inertia to die down
+	constexpr float smooth_time = .08f;
+	constexpr float inertia_time = .35f;
 }
 
+// uniforms shared by every program, laid out as SceneBlock
+#define SCENE_BLOCK \
+	"layout(std140) uniform Scene{" \
+	"mat4 trans_mat;" \
+	"vec4 hl_color;" \
+	"float amplitude;" \
+	"};"
+
 const char* ModelRenderer::vertexSource =
-	"#version 130\n"
-	"in vec3 position;"
-	"in vec3 i_color;"
+	"#version 330 core\n"
+	"layout(location=0) in vec3 position;"
+	"layout(location=1) in vec3 i_color;"
+	"layout(location=4) in float i_highlight;"
+	"layout(location=5) in vec3 i_displacement;"
+	"out vec3 m_color;"
+	SCENE_BLOCK
+	"void main(){"
+	"gl_Position=trans_mat*vec4(position+amplitude*i_displacement,1.0);"
+	"m_color=mix(i_color,hl_color.rgb,i_highlight);"
+	"}";
+
+// unit mesh along the x axis, turned to the y or z axis and scaled per instance
+// the centre moves with the displacement of its node, the glyph itself keeps its shape
+const char* ModelRenderer::glyphSource =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 mesh;"
+	"layout(location=2) in vec3 centre;"
+	"layout(location=3) in vec2 placement;"
+	"layout(location=5) in vec3 i_displacement;"
 	"out vec3 m_color;"
-	"uniform mat4 trans_mat;"
+	SCENE_BLOCK
+	"uniform float size;"
+	"uniform vec3 color;"
+	"void main(){"
+	"vec3 shape=placement.x<.5?mesh:placement.x<1.5?mesh.yxz:mesh.zyx;"
+	"gl_Position=trans_mat*vec4(centre+amplitude*i_displacement+placement.y*size*shape,1.0);"
+	"m_color=color;"
+	"}";
+
+// screen aligned quad of one digit, anchored at the projected label position
+// cell holds the width and height of a character and the baseline offset, all in device pixels
+// the quad takes the depth of the anchor moved by lift along toward, the model space direction to the camera
+const char* ModelRenderer::labelSource =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 mesh;"
+	"layout(location=2) in vec3 centre;"
+	"layout(location=3) in vec2 placement;"
+	"layout(location=5) in vec3 i_displacement;"
+	"out vec2 m_uv;"
+	SCENE_BLOCK
+	"uniform vec3 shift;"
+	"uniform vec3 cell;"
+	"uniform vec2 viewport;"
+	"uniform vec3 toward;"
+	"uniform float lift;"
 	"void main(){"
-	"gl_Position=trans_mat*vec4(position,1.0);"
-	"m_color=i_color;"
+	"vec3 moved=centre+amplitude*i_displacement+shift;"
+	"vec4 anchor=trans_mat*vec4(moved,1.0);"
+	"vec4 front=trans_mat*vec4(moved+lift*toward,1.0);"
+	"float depth=front.w>0.0?max(front.z/front.w,-1.0):-1.0;"
+	"vec2 offset=vec2((placement.y+mesh.x)*cell.x,mesh.y*cell.y-cell.z)*2.0/viewport;"
+	"gl_Position=anchor.w<=0.0||abs(anchor.z)>anchor.w?vec4(2.0,2.0,2.0,1.0):vec4(anchor.xy+offset*anchor.w,depth*anchor.w,anchor.w);"
+	"m_uv=vec2((placement.x+mesh.x)/10.0,1.0-mesh.y);"
+	"}";
+
+// unit box stretched between the ends of a member, both ends moved by their displacements
+// the box is as wide as section.x along the given axis, made square to the member, and as thick as section.y across both
+// section.z picks the axis, one to three for x to z, and section.w is the highlight
+const char* ModelRenderer::memberSource =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 mesh;"
+	"layout(location=1) in vec3 normal;"
+	"layout(location=2) in vec3 start;"
+	"layout(location=3) in vec3 end;"
+	"layout(location=4) in vec3 start_shift;"
+	"layout(location=5) in vec3 end_shift;"
+	"layout(location=6) in vec4 section;"
+	"out vec3 m_color;"
+	SCENE_BLOCK
+	"uniform vec3 light;"
+	"uniform vec3 color;"
+	"void main(){"
+	"vec3 origin=start+amplitude*start_shift;"
+	"vec3 axis=end+amplitude*end_shift-origin;"
+	"vec3 along=normalize(axis);"
+	"vec3 hint=section.z<1.5?vec3(1.0,0.0,0.0):section.z<2.5?vec3(0.0,1.0,0.0):vec3(0.0,0.0,1.0);"
+	"vec3 side=hint-dot(hint,along)*along;"
+	"if(dot(side,side)<1e-6)side=abs(along.z)<.9?cross(vec3(0.0,0.0,1.0),along):vec3(1.0,0.0,0.0);"
+	"side=normalize(side);"
+	"vec3 across=cross(along,side);"
+	"gl_Position=trans_mat*vec4(origin+mesh.x*axis+mesh.y*section.x*side+mesh.z*section.y*across,1.0);"
+	"vec3 facing=normal.x*along+normal.y*side+normal.z*across;"
+	"m_color=mix(color,hl_color.rgb,section.w)*(.35+.65*abs(dot(facing,light)));"
+	"}";
+
+// labels are drawn in the highlight colour
+const char* ModelRenderer::labelFragmentSource =
+	"#version 330 core\n"
+	"in vec2 m_uv;"
+	"layout(location=0) out vec4 o_color;"
+	SCENE_BLOCK
+	"uniform sampler2D atlas;"
+	"void main(){"
+	"o_color=vec4(hl_color.rgb,texture(atlas,m_uv).a);"
+	"}";
+
+// position of the vertex in the draw, taken as the index of a node or an element and packed into the colour
+// kind goes into alpha to tell nodes from elements
+const char* ModelRenderer::pickSource =
+	"#version 330 core\n"
+	"layout(location=0) in vec3 position;"
+	"layout(location=5) in vec3 i_displacement;"
+	"flat out vec4 m_id;"
+	SCENE_BLOCK
+	"uniform int divisor;"
+	"uniform float kind;"
+	"void main(){"
+	"gl_Position=trans_mat*vec4(position+amplitude*i_displacement,1.0);"
+	"int id=gl_VertexID/divisor+1;"
+	"m_id=vec4(float(id&255),float((id>>8)&255),float((id>>16)&255),kind)/255.0;"
+	"}";
+
+const char* ModelRenderer::pickFragmentSource =
+	"#version 330 core\n"
+	"flat in vec4 m_id;"
+	"layout(location=0) out vec4 o_color;"
+	"void main(){"
+	"o_color=m_id;"
 	"}";
 
 const char* ModelRenderer::fragmentSource =
-	"#version 130\n"
+	"#version 330 core\n"
 	"in vec3 m_color;"
-	"out vec4 o_color;"
+	"layout(location=0) out vec4 o_color;"
 	"void main(){"
 	"o_color=vec4(m_color,1.);"
 	"}";
 
+#undef SCENE_BLOCK
+
 void ModelRenderer::setModel(Database* ptr) { model_ptr = ptr; }
 
 void ModelRenderer::resetView() {
-	View = PlotView();
+	auto home = PlotView();
+
+	View.FOV = home.FOV;
+
+	const auto target = camera(aim());
+	const auto origin = camera(home);
+	for(auto I = 0llu; I < target.size(); ++I) *target[I] = *origin[I];
 
-	repaint();
+	view_velocity.fill(0.f);
+	moving = true;
+	requestFrame();
+}
+
+void ModelRenderer::fitModel() {
+	if(!model_ptr) return;
+
+	if(const auto& bounds = model_ptr->getBounds(); !bounds.empty) fitView(bounds.centre(), bounds.radius());
+}
+
+void ModelRenderer::fitSelection() {
+	if(!model_ptr) return;
+
+	if(const auto& bounds = model_ptr->getSelectionBounds(); !bounds.empty) fitView(bounds.centre(), bounds.radius());
+}
+
+void ModelRenderer::fitView(const QVector3D& centre, const float radius) {
+	frame(aim(), centre, radius);
+
+	view_velocity.fill(0.f);
+	moving = true;
+	requestFrame();
+}
+
+void ModelRenderer::setCamera(const PlotView& view) {
+	View.XR = normaliseAngle(view.XR);
+	View.YR = normaliseAngle(view.YR);
+	View.ZR = normaliseAngle(view.ZR);
+	View.FOV = view.FOV;
+
+	if(model_ptr)
+		if(const auto& bounds = model_ptr->getBounds(); !bounds.empty) frame(View, bounds.centre(), bounds.radius());
+
+	view_target = View;
+	view_velocity.fill(0.f);
+	moving = false;
+	detail = full_detail;
+
+	update();
+}
+
+// keeps the rotation and moves the camera so that the given sphere fills the narrower side of the view
+void ModelRenderer::frame(PlotView& target, const QVector3D& centre, const float radius) const {
+	QMatrix4x4 rotation;
+	rotation.rotate(target.XR, 1, 0, 0);
+	rotation.rotate(target.YR, 0, 1, 0);
+	rotation.rotate(target.ZR, 0, 0, 1);
+
+	const auto half_fov = qDegreesToRadians(.5f * View.FOV);
+	const auto aspect = static_cast<float>(width()) / static_cast<float>(std::max(1, height()));
+	const auto half_angle = std::min(half_fov, std::atan(std::tan(half_fov) * aspect));
+
+	// a single node still gets a sensible distance
+	const auto distance = std::max(radius, 1E-3f * std::max(1.f, centre.length())) / std::sin(half_angle);
+
+	const auto t_vec = QVector3D(0.f, 0.f, -distance) - rotation.map(centre);
+
+	target.XT = t_vec.x();
+	target.YT = t_vec.y();
+	target.ZT = t_vec.z();
+}
+
+std::array<float*, 6> ModelRenderer::camera(PlotView& view) { return {&view.XR, &view.YR, &view.ZR, &view.XT, &view.YT, &view.ZT}; }
+
+PlotSetting::PlotView& ModelRenderer::aim() {
+	// a new motion starts from where the camera is
+	if(!moving) {
+		view_target = View;
+		last_step = frame_clock.nsecsElapsed();
+	}
+
+	return view_target;
+}
+
+void ModelRenderer::moveCamera(const std::array<float, 6>& delta) {
+	const auto target = camera(aim());
+	for(auto I = 0llu; I < delta.size(); ++I) *target[I] += delta[I];
+
+	// speed of the last few events, carried on after release with inertia
+	const auto now = frame_clock.nsecsElapsed();
+	const auto elapsed = 1E-9f * static_cast<float>(now - last_move);
+	last_move = now;
+	for(auto I = 0llu; I < delta.size(); ++I) view_velocity[I] = elapsed > 0.f && elapsed < .1f ? .5f * view_velocity[I] + .5f * delta[I] / elapsed : 0.f;
+
+	moving = true;
+	requestFrame();
+}
+
+void ModelRenderer::stepCamera() {
+	if(!moving) return;
+
+	const auto now = frame_clock.nsecsElapsed();
+	const auto elapsed = std::clamp(1E-9f * static_cast<float>(now - last_step), 0.f, .1f);
+	last_step = now;
+
+	const auto target = camera(view_target);
+	const auto current = camera(View);
+
+	const auto coasting = Switch.INERTIA && !dragging;
+	if(coasting) {
+		const auto decay = std::exp(-elapsed / inertia_time);
+		for(auto I = 0llu; I < target.size(); ++I) {
+			*target[I] += view_velocity[I] * elapsed;
+			view_velocity[I] *= decay;
+		}
+	}
+
+	const auto follow = Switch.SMOOTH ? 1.f - std::exp(-elapsed / smooth_time) : 1.f;
+	const auto scale = std::max(1E-3f, std::abs(view_target.ZT));
+
+	auto settled = true;
+	for(auto I = 0llu; I < target.size(); ++I) {
+		// angles turn the short way round
+		const auto gap = I < 3 ? std::remainder(*target[I] - *current[I], 360.f) : *target[I] - *current[I];
+		*current[I] += follow * gap;
+
+		const auto tolerance = I < 3 ? 1E-2f : 1E-4f * scale;
+		settled &= std::abs(gap) < tolerance && (!coasting || std::abs(view_velocity[I]) < 10.f * tolerance);
+	}
+
+	if(!settled) return;
+
+	for(auto I = 0llu; I < target.size(); ++I) *current[I] = *target[I];
+	for(auto I = 0llu; I < 3; ++I) *current[I] = *target[I] = normaliseAngle(*target[I]);
+
+	moving = false;
+
+	if(!dragging) finishMotion();
+}
+
+void ModelRenderer::requestFrame() {
+	if(0 == request_time) request_time = frame_clock.nsecsElapsed();
+
+	update();
+}
+
+void ModelRenderer::nextFrame() {
+	const auto now = frame_clock.nsecsElapsed();
+	const auto refresh = screen() ? screen()->refreshRate() : 60.;
+	const auto period = 1E9 / (refresh > 0. ? refresh : 60.);
+
+	// the swap waits for the display, so asking for the next frame here keeps the loop in step with it
+	// only frames of a motion count, an animation alone runs without end
+	if(0 != painted_request && painted_navigating) {
+		const auto latency = static_cast<double>(now - painted_request);
+
+		++frame_count;
+		frame_dropped += std::max(0, static_cast<int>(latency / period) - 1);
+
+		// from the request to the swap is the drawing plus at most one wait for the display
+		adaptResolution(static_cast<float>(1E-6 * latency), static_cast<float>(1E-6 * period));
+	}
+
+	painted_request = 0;
+
+	if(moving) requestFrame();
+}
+
+// fill cost goes with the area, so the scale follows the square root of the time ratio when too slow
+// and creeps back up while frames keep up with the display
+void ModelRenderer::adaptResolution(const float frame_time, const float refresh_time) {
+	const auto target = std::max(Resolution.FRAME_TIME, refresh_time);
+
+	if(frame_time > 1.2f * target) view_scale *= std::sqrt(target / frame_time);
+	else if(frame_time < 1.05f * target) view_scale *= 1.05f;
+
+	view_scale = std::clamp(view_scale, std::clamp(Resolution.MINIMUM, .1f, 1.f), 1.f);
+}
+
+void ModelRenderer::finishMotion() {
+	if(frame_dropped > 0) emit framesDropped(frame_dropped, frame_count);
+
+	frame_count = frame_dropped = 0;
+}
+
+ModelRenderer::~ModelRenderer() {
+	makeCurrent();
+	for(auto* layer : layers()) {
+		layer->vao.destroy();
+		layer->vbo.destroy();
+		layer->ibo.destroy();
+	}
+	node_flag.destroy();
+	node_displacement.destroy();
+	element_selection.destroy();
+	glyph_mesh.destroy();
+	m_program.reset();
+	m_glyph_program.reset();
+	m_label_program.reset();
+	m_pick_program.reset();
+	m_member_program.reset();
+	box_mesh.destroy();
+	element_pick.destroy();
+	pick_vao.destroy();
+	if(0 != scene_block) glDeleteBuffers(1, &scene_block);
+	pick_target.reset();
+	scale_target.reset();
+	label_atlas.reset();
+	doneCurrent();
 }
 
 void ModelRenderer::initializeGL() {
 	initializeOpenGLFunctions();
-	glEnable(GL_DEPTH_TEST | GL_CULL_FACE | GL_LINE_SMOOTH);
-
-	m_program = std::make_unique<QOpenGLShaderProgram>();
-	m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource);
-	m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
-	m_program->bindAttributeLocation("position", 0);
-	m_program->bindAttributeLocation("i_color", 1);
-	m_program->link();
-	m_program->bind();
 
-	m_trans_mat = m_program->uniformLocation("trans_mat");
+	// a context that is not what was asked for draws nothing rather than failing on every call
+	m_program.reset();
+	if(const auto version = context()->format().version(); context()->isOpenGLES() || version < qMakePair(3, 3)) {
+		qWarning("OpenGL 3.3 is required to draw the model, the context is %d.%d.", version.first, version.second);
+		return;
+	}
 
-	m_program->release();
+	// attribute locations are fixed in the shaders, every program reads the shared block at the same binding point
+	const auto build = [&](const char* vertex, const char* fragment) {
+		auto program = std::make_unique<QOpenGLShaderProgram>();
+		program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertex);
+		program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment);
+		program->link();
+		if(const auto block = glGetUniformBlockIndex(program->programId(), "Scene"); GL_INVALID_INDEX != block) glUniformBlockBinding(program->programId(), block, scene_binding);
+		return program;
+	};
+
+	m_program = build(vertexSource, fragmentSource);
+
+	m_glyph_program = build(glyphSource, fragmentSource);
+
+	m_glyph_size = m_glyph_program->uniformLocation("size");
+	m_glyph_color = m_glyph_program->uniformLocation("color");
+
+	m_label_program = build(labelSource, labelFragmentSource);
+
+	m_label_shift = m_label_program->uniformLocation("shift");
+	m_label_cell = m_label_program->uniformLocation("cell");
+	m_label_viewport = m_label_program->uniformLocation("viewport");
+	m_label_atlas = m_label_program->uniformLocation("atlas");
+	m_label_toward = m_label_program->uniformLocation("toward");
+	m_label_lift = m_label_program->uniformLocation("lift");
+
+	m_pick_program = build(pickSource, pickFragmentSource);
+
+	m_pick_divisor = m_pick_program->uniformLocation("divisor");
+	m_pick_kind = m_pick_program->uniformLocation("kind");
+
+	m_member_program = build(memberSource, fragmentSource);
+
+	m_member_light = m_member_program->uniformLocation("light");
+	m_member_color = m_member_program->uniformLocation("color");
 
-	m_buffer.create();
+	glGenBuffers(1, &scene_block);
+	glBindBuffer(GL_UNIFORM_BUFFER, scene_block);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// lines wider than a pixel are not available everywhere in the core profile, so widths are kept to what is
+	std::array<GLfloat, 2> range{1.f, 1.f};
+	glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, range.data());
+	max_line_width = std::max(1.f, range[1]);
+
+	element_pick.create();
+	element_pick_revision = 0;
+	pick_target.reset();
+	scale_target.reset();
+
+	// picking points its two attributes straight at the node and element buffers
+	pick_vao.create();
+	pick_vao.bind();
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(5);
+	pick_vao.release();
+
+	createAtlas(devicePixelRatioF());
+
+	if(!frame_clock.isValid()) frame_clock.start();
+	connect(this, &QOpenGLWidget::frameSwapped, this, &ModelRenderer::nextFrame, Qt::UniqueConnection);
+
+	glyph_mesh.create();
+	glyph_mesh.bind();
+	glyph_mesh.allocate(glyph_mesh_data, sizeof(glyph_mesh_data));
+	glyph_mesh.release();
+
+	box_mesh.create();
+	box_mesh.bind();
+	box_mesh.allocate(box_mesh_data, sizeof(box_mesh_data));
+	box_mesh.release();
+	member_selection.fill(0);
+
+	element_layer.ibo.create();
+	mass_layer.ibo.create();
+	node_layer.ibo.create();
+	node_sample_stride = 1;
+	node_flag.create();
+	node_displacement.create();
+	element_selection.create();
+	node_flag_data.clear();
+	node_displacement_data.clear();
+	element_selection_data.clear();
+	node_flag_revision = element_selection_revision = 0;
+
+	// the context may be recreated, in which case everything is uploaded again
+	for(auto* layer : layers()) {
+		layer->data.clear();
+		layer->index.clear();
+		layer->revision = layer->style = 0;
+
+		layer->vbo.create();
+		layer->vao.create();
+		layer->vao.bind();
+		setAttributes(*layer);
+		layer->vao.release();
+	}
 }
 
 void ModelRenderer::paintGL() {
+	FMC_ALLOCATION_SCOPE("frame");
+
 	glClearColor(Color.BG.redF(), Color.BG.greenF(), Color.BG.blueF(), 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	// whatever asked for a frame since the last one is drawn by this one
+	painted_request = request_time;
+	request_time = 0;
+
+	// the widget may be shown before it is given a model, or without a context it can draw with
+	if(!model_ptr || !m_program) return;
+
+	stepCamera();
+
+	// while navigating the frame may be drawn into the corner of an offscreen target and stretched over the widget
+	const auto navigating = painted_navigating = moving || dragging;
+	const auto ratio = devicePixelRatioF();
+	const auto full = QSize(static_cast<int>(ratio * width()), static_cast<int>(ratio * height()));
+	const auto scaled = navigating && Resolution.ADAPTIVE && view_scale < 1.f && QOpenGLFramebufferObject::hasOpenGLFramebufferBlit();
+	const auto reduced = scaled ? QSize(std::max(1, static_cast<int>(view_scale * static_cast<float>(full.width()))), std::max(1, static_cast<int>(view_scale * static_cast<float>(full.height())))) : full;
+
+	if(scaled) {
+		// allocated at full size once, so a change of scale only changes the viewport
+		if(!scale_target || scale_target->size() != full) scale_target = std::make_unique<QOpenGLFramebufferObject>(full, QOpenGLFramebufferObject::Depth);
+		scale_target->bind();
+		glViewport(0, 0, reduced.width(), reduced.height());
+	}
+
+	// sizes in pixels shrink with the target so that they look the same once stretched
+	pixel_scale = scaled ? static_cast<float>(reduced.width()) / static_cast<float>(full.width()) : 1.f;
+
+	glClearColor(Color.BG.redF(), Color.BG.greenF(), Color.BG.blueF(), 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// the deformed shape is the only thing that changes while animating, and only through this uniform
+	deform_amplitude = 0.f;
+	if(Deform.SHOW) {
+		deform_amplitude = Deform.SCALE;
+		if(Deform.ANIMATE) {
+			// phase taken in double so that it stays smooth however long the session runs
+			const auto phase = std::fmod(1E-9 * static_cast<double>(frame_clock.nsecsElapsed()) / std::max(.1, static_cast<double>(Deform.PERIOD)), 1.);
+			deform_amplitude *= static_cast<float>(std::sin(qDegreesToRadians(360. * phase)));
+		}
+	}
+
 	setPlane();
 
+	current_trans = scene_trans = getTransformation();
+	scene_viewport = tile_viewport = QSizeF(full);
+
+	// cheap frames while the camera moves, the details come back one frame at a time once it settles
+	if(navigating) detail = 0;
+	const auto level = detail;
+	if(!navigating && detail < full_detail) {
+		++detail;
+		requestFrame();
+	}
+
+	paintScene(level);
+
+	if(scaled) {
+		scale_target->release();
+		QOpenGLFramebufferObject::blitFramebuffer(nullptr, QRect(QPoint(), full), scale_target.get(), QRect(QPoint(), reduced), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glViewport(0, 0, full.width(), full.height());
+	}
+
+	if(Region::None != region_mode) paintRegion();
+
+	if(Deform.SHOW && Deform.ANIMATE) requestFrame();
+}
+
+// everything up to the given detail level, through the current transformation into the current target
+void ModelRenderer::paintScene(const int level) {
+	// painting the region with QPainter leaves its own state behind, so the state of the scene is set on every pass
+	// later passes over the same lines, such as the highlighted elements, must pass at equal depth
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+
+	updateScene();
+
 	m_program->bind();
-	m_program->setUniformValue(m_trans_mat, current_trans = getTransformation());
 
-	glPointSize(1);
-	glLineWidth(1);
+	// only the node layer carries highlight flags and displacements, the other layers read these constants
+	glVertexAttrib1f(4, 0.f);
+	glVertexAttrib3f(5, 0.f, 0.f, 0.f);
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+	model_revision = model_ptr->getRevision();
+
+	glPointSize(1);
+	setLineWidth(1);
 
 	if(Switch.AXIS) paintAxis();
 
-	glPointSize(Size.PT);
-	glLineWidth(Size.LINE_WIDTH);
+	glPointSize(pixel_scale * Size.PT);
+	setLineWidth(pixel_scale * Size.LINE_WIDTH);
 
-	paintNode();
+	paintNode(level < 1);
 	paintElement();
-	paintBC();
-	paintLoad();
-	paintMass();
+	if(level >= 2) {
+		paintBC();
+		paintLoad();
+	}
+	if(level >= 1) paintMass();
 
-	if(Switch.NODE_LABEL) paintNodeLabel();
-	if(Switch.ELEMENT_LABEL) paintElementLabel();
+	if(level >= 3 && (Switch.NODE_LABEL || Switch.ELEMENT_LABEL)) paintLabel();
 
 	m_program->release();
 }
 
+void ModelRenderer::updateScene() {
+	SceneBlock block{};
+	std::copy_n(current_trans.constData(), block.trans_mat.size(), block.trans_mat.begin());
+	block.hl_color = {static_cast<GLfloat>(Color.HL.redF()), static_cast<GLfloat>(Color.HL.greenF()), static_cast<GLfloat>(Color.HL.blueF()), 1.f};
+	block.amplitude = deform_amplitude;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, scene_block);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, scene_binding, scene_block);
+}
+
+void ModelRenderer::setLineWidth(const float width) { glLineWidth(std::clamp(width, 1.f, max_line_width)); }
+
+QImage ModelRenderer::renderImage(const QSize& size) {
+	if(!isValid() || !model_ptr || !m_program || size.isEmpty()) return {};
+
+	// three bytes a pixel, a poster of 16k pixels across is several hundred megabytes
+	QImage image(size, QImage::Format_RGB888);
+	if(image.isNull()) return {};
+
+	makeCurrent();
+
+	const auto ratio = devicePixelRatioF();
+	const auto scale = static_cast<float>(size.width()) / std::max(1.f, static_cast<float>(ratio * width()));
+
+	std::array<GLint, 2> limit{};
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, limit.data());
+	const auto tile = std::max(1, std::min({export_tile, limit[0], limit[1]}));
+
+	auto target = std::make_unique<QOpenGLFramebufferObject>(QSize(tile, tile), QOpenGLFramebufferObject::Depth);
+	std::vector<GLubyte> pixel(4llu * tile * tile);
+
+	// the widget keeps what it was drawn with for picking and selecting
+	const auto widget_trans = current_trans;
+
+	// digits are drawn at the resolution of the image, and the labels are laid out once over the whole of it
+	// so that every tile shows the same labels at the same places
+	createAtlas(ratio * scale);
+	pixel_scale = scale;
+
+	setPlane();
+	scene_trans = getTransformation(static_cast<float>(size.width()) / static_cast<float>(size.height()));
+	scene_viewport = QSizeF(size);
+
+	target->bind();
+
+	for(auto y = 0; y < size.height(); y += tile)
+		for(auto x = 0; x < size.width(); x += tile) {
+			const auto w = std::min(tile, size.width() - x);
+			const auto h = std::min(tile, size.height() - y);
+
+			// the part of the picture under the tile is stretched over the clip space, y counts from the bottom
+			QMatrix4x4 crop;
+			crop.translate((static_cast<float>(size.width()) - 2.f * static_cast<float>(x)) / static_cast<float>(w) - 1.f, (static_cast<float>(size.height()) - 2.f * static_cast<float>(y)) / static_cast<float>(h) - 1.f, 0.f);
+			crop.scale(static_cast<float>(size.width()) / static_cast<float>(w), static_cast<float>(size.height()) / static_cast<float>(h), 1.f);
+			current_trans = crop * scene_trans;
+			tile_viewport = QSizeF(w, h);
+
+			glViewport(0, 0, w, h);
+			glClearColor(Color.BG.redF(), Color.BG.greenF(), Color.BG.blueF(), 1);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			paintScene(full_detail);
+
+			glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixel.data());
+
+			// rows come bottom up and go into the image top down
+			for(auto R = 0; R < h; ++R) {
+				const auto* source = pixel.data() + 4llu * w * R;
+				auto* line = image.scanLine(size.height() - 1 - y - R) + 3ll * x;
+				for(auto C = 0; C < w; ++C)
+					for(auto K = 0; K < 3; ++K) line[3 * C + K] = source[4 * C + K];
+			}
+		}
+
+	target->release();
+	target.reset();
+
+	createAtlas(ratio);
+	pixel_scale = 1.f;
+	current_trans = widget_trans;
+
+	doneCurrent();
+
+	// labels are laid out again for the widget
+	update();
+
+	return image;
+}
+
 void ModelRenderer::paintAxis() {
-	auto idx = 36;
-
-	const auto limit = Size.GRID_NUM / 2;
-
-	std::vector<GLfloat> verts(idx + (2llu * limit + 1llu) * 24, 0.);
-
-	verts[0] = verts[13] = verts[26] = -0.f * (verts[6] = verts[19] = verts[32] = Size.AXIS);
-	verts[3] = verts[9] = verts[16] = verts[22] = verts[29] = verts[35] = 1;
-
-	const auto bound = static_cast<float>(limit) * Size.GRID;
-
-	for(auto I = -limit; I <= limit; ++I) {
-		const auto edge = static_cast<float>(I) * Size.GRID;
-		verts[idx] = edge;
-		verts[idx + 1ll] = -bound;
-		verts[idx + 3ll] = Color.GRID.redF();
-		verts[idx + 4ll] = Color.GRID.greenF();
-		verts[idx + 5ll] = Color.GRID.blueF();
-		idx += 6;
-		verts[idx] = edge;
-		verts[idx + 1ll] = 0 == I ? 0 : bound;
-		verts[idx + 3ll] = Color.GRID.redF();
-		verts[idx + 4ll] = Color.GRID.greenF();
-		verts[idx + 5ll] = Color.GRID.blueF();
-		idx += 6;
-		verts[idx] = -bound;
-		verts[idx + 1ll] = edge;
-		verts[idx + 3ll] = Color.GRID.redF();
-		verts[idx + 4ll] = Color.GRID.greenF();
-		verts[idx + 5ll] = Color.GRID.blueF();
-		idx += 6;
-		verts[idx] = 0 == I ? 0 : bound;
-		verts[idx + 1ll] = edge;
-		verts[idx + 3ll] = Color.GRID.redF();
-		verts[idx + 4ll] = Color.GRID.greenF();
-		verts[idx + 5ll] = Color.GRID.blueF();
-		idx += 6;
-	}
-
-	m_buffer.bind();
-
-	m_buffer.allocate(verts.data(), sizeof(GLfloat) * static_cast<int>(verts.size()));
+	if(stale(axis_layer)) {
+		auto idx = 36;
+
+		const auto limit = Size.GRID_NUM / 2;
+
+		std::vector<GLfloat> verts(idx + (2llu * limit + 1llu) * 24, 0.);
+
+		verts[0] = verts[13] = verts[26] = -0.f * (verts[6] = verts[19] = verts[32] = Size.AXIS);
+		verts[3] = verts[9] = verts[16] = verts[22] = verts[29] = verts[35] = 1;
+
+		const auto bound = static_cast<float>(limit) * Size.GRID;
+
+		for(auto I = -limit; I <= limit; ++I) {
+			const auto edge = static_cast<float>(I) * Size.GRID;
+			verts[idx] = edge;
+			verts[idx + 1ll] = -bound;
+			verts[idx + 3ll] = Color.GRID.redF();
+			verts[idx + 4ll] = Color.GRID.greenF();
+			verts[idx + 5ll] = Color.GRID.blueF();
+			idx += 6;
+			verts[idx] = edge;
+			verts[idx + 1ll] = 0 == I ? 0 : bound;
+			verts[idx + 3ll] = Color.GRID.redF();
+			verts[idx + 4ll] = Color.GRID.greenF();
+			verts[idx + 5ll] = Color.GRID.blueF();
+			idx += 6;
+			verts[idx] = -bound;
+			verts[idx + 1ll] = edge;
+			verts[idx + 3ll] = Color.GRID.redF();
+			verts[idx + 4ll] = Color.GRID.greenF();
+			verts[idx + 5ll] = Color.GRID.blueF();
+			idx += 6;
+			verts[idx] = 0 == I ? 0 : bound;
+			verts[idx + 1ll] = edge;
+			verts[idx + 3ll] = Color.GRID.redF();
+			verts[idx + 4ll] = Color.GRID.greenF();
+			verts[idx + 5ll] = Color.GRID.blueF();
+			idx += 6;
+		}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+		upload(axis_layer, std::move(verts));
+	}
+
+	bind(axis_layer);
 
-	m_buffer.release();
+	glDrawArrays(GL_LINES, 0, axis_layer.size());
 
-	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(verts.size() / 6));
+	release(axis_layer);
 }
 
-void ModelRenderer::paintNode() {
-	std::vector<GLfloat> node_data;
+void ModelRenderer::paintNode(const bool sampled) {
+	const auto rebuilt = stale(node_layer);
 
-	const auto& node_pool = model_ptr->getNodePool();
+	if(rebuilt) {
+		const auto& node_pool = model_ptr->getNodePool();
+
+		// the same nodes at new places keep their vertices, so the tree is refitted and the element indices stay valid
+		auto moved = node_pool.size() == node_tag.size();
+		for(auto I = 0llu; I < node_tag.size() && moved; ++I) moved = node_pool.count(node_tag[I]) != 0;
 
-	node_data.reserve(6 * node_pool.size());
+		std::vector<ClusterTree::Box> box;
 
-	for(auto& [fst, snd] : node_pool) {
-		node_data.emplace_back(snd.position.x());
-		node_data.emplace_back(snd.position.y());
-		node_data.emplace_back(snd.position.z());
-		if(snd.highlighted) {
-			node_data.emplace_back(Color.HL.redF());
-			node_data.emplace_back(Color.HL.greenF());
-			node_data.emplace_back(Color.HL.blueF());
+		if(moved) {
+			const auto& order = node_tree.getOrder();
+			box.resize(node_tag.size());
+			for(auto I = 0llu; I < node_tag.size(); ++I) {
+				const auto& position = node_pool.at(node_tag[I]).position;
+				box[order[I]] = {position, position};
+			}
+			node_tree.refit(box);
 		} else {
+			std::vector<int> tag;
+			tag.reserve(node_pool.size());
+			box.reserve(node_pool.size());
+			for(auto& [fst, snd] : node_pool) {
+				tag.emplace_back(fst);
+				box.push_back({snd.position, snd.position});
+			}
+			node_tree.build(box);
+
+			const auto& order = node_tree.getOrder();
+			node_tag.resize(tag.size());
+			node_slot.clear();
+			node_slot.reserve(tag.size());
+			for(auto I = 0llu; I < tag.size(); ++I) node_slot.emplace(node_tag[I] = tag[order[I]], static_cast<GLuint>(I));
+		}
+
+		std::vector<GLfloat> node_data;
+		node_data.reserve(6 * node_tag.size());
+
+		for(auto& axis : node_position) axis.resize(node_tag.size());
+
+		for(auto I = 0llu; I < node_tag.size(); ++I) {
+			const auto& position = node_pool.at(node_tag[I]).position;
+			for(auto J = 0; J < 3; ++J) node_position[J][I] = position[J];
+			node_data.emplace_back(position.x());
+			node_data.emplace_back(position.y());
+			node_data.emplace_back(position.z());
 			node_data.emplace_back(Color.NODE.redF());
 			node_data.emplace_back(Color.NODE.greenF());
 			node_data.emplace_back(Color.NODE.blueF());
 		}
+
+		upload(node_layer, std::move(node_data));
+
+		updateNodeDisplacement();
+
+		// every so many vertices, which is an even spread as vertices follow the tree
+		const auto node_num = static_cast<GLuint>(node_tag.size());
+		node_sample_stride = std::max(1u, (node_num + node_budget - 1) / node_budget);
+		if(node_sample_stride > 1) {
+			std::vector<GLuint> sample;
+			sample.reserve(node_num / node_sample_stride + 1);
+			for(auto I = 0u; I < node_num; I += node_sample_stride) sample.emplace_back(I);
+
+			node_layer.ibo.bind();
+			node_layer.ibo.allocate(sample.data(), sizeof(GLuint) * static_cast<int>(sample.size()));
+			node_layer.ibo.release();
+		}
 	}
 
-	m_buffer.bind();
+	updateNodeFlag(rebuilt);
 
-	m_buffer.allocate(node_data.data(), sizeof(GLfloat) * static_cast<int>(node_data.size()));
+	visible.clear();
+	node_tree.cull(current_trans, deformMargin(), visible);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+	bind(node_layer);
 
-	glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(node_pool.size()));
+	if(sampled && node_sample_stride > 1) {
+		const auto stride = node_sample_stride;
+		node_layer.ibo.bind();
+		for(const auto& [first, count] : visible) {
+			const auto lower = (first + stride - 1) / stride;
+			const auto upper = (first + count + stride - 1) / stride;
+			if(upper > lower) glDrawElements(GL_POINTS, static_cast<GLsizei>(upper - lower), GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(GLuint) * lower));
+		}
+	} else
+		for(const auto& [first, count] : visible) glDrawArrays(GL_POINTS, static_cast<GLint>(first), static_cast<GLsizei>(count));
 
-	m_buffer.release();
+	release(node_layer);
 }
 
-void ModelRenderer::paintNodeLabel() {
-	const auto& node_pool = model_ptr->getNodePool();
+void ModelRenderer::paintElement() {
+	const auto rebuilt = stale(element_layer);
+
+	if(rebuilt) {
+		// indices of both nodes, grouped by colour: frame, brace, wall
+		std::array<std::vector<GLuint>, 3> group;
+		std::array<std::vector<int>, 3> group_tag;
+
+		for(const auto& [fst, snd] : model_ptr->getElementPool()) {
+			if(snd.type == Database::Element::Type::Wall && !Switch.WALL) continue;
+			if(snd.type == Database::Element::Type::Frame && !Switch.FRAME) continue;
+			if(snd.type == Database::Element::Type::Brace && !Switch.BRACE) continue;
+
+			const auto J = snd.type == Database::Element::Type::Frame ? 0 : snd.type == Database::Element::Type::Brace ? 1 : 2;
+			group[J].emplace_back(node_slot.at(snd.encoding[0]));
+			group[J].emplace_back(node_slot.at(snd.encoding[1]));
+			group_tag[J].emplace_back(fst);
+		}
 
-	QPainter painter(this);
-	painter.setPen(Color.HL);
-	QFont font;
-	font.setPointSize(14);
-	painter.setFont(font);
+		const auto& node_data = node_layer.data;
+		const auto point = [&](const GLuint slot) { return QVector3D(node_data[6llu * slot], node_data[6llu * slot + 1], node_data[6llu * slot + 2]); };
+
+		std::vector<GLuint> index;
+		index.reserve(group[0].size() + group[1].size() + group[2].size());
+		element_tag.clear();
+		for(auto J = 0llu; J < group.size(); ++J) {
+			std::vector<ClusterTree::Box> box;
+			box.reserve(group[J].size() / 2);
+			for(auto K = 0llu; K < group[J].size(); K += 2) {
+				ClusterTree::Box segment{point(group[J][K]), point(group[J][K])};
+				segment.expand({point(group[J][K + 1]), point(group[J][K + 1])});
+				box.push_back(segment);
+			}
+
+			if(group[J] == element_source[J]) element_tree[J].refit(box);
+			else {
+				element_tree[J].build(box);
+				element_source[J] = group[J];
+			}
+
+			element_count[J] = static_cast<GLsizei>(group[J].size());
+			for(const auto I : element_tree[J].getOrder()) {
+				index.emplace_back(group[J][2llu * I]);
+				index.emplace_back(group[J][2llu * I + 1]);
+				element_tag.emplace_back(group_tag[J][I]);
+			}
+		}
 
-	for(auto& [fst, snd] : node_pool) {
-		const auto text = QString::number(fst);
-		renderLabel(painter, snd.position + QVector3D{Size.XSHIFT, Size.YSHIFT, Size.ZSHIFT}, text);
+		// moving nodes only changes the node buffer, the indices stay the same
+		if(index != element_layer.index) {
+			element_layer.ibo.bind();
+			element_layer.ibo.allocate(index.data(), sizeof(GLuint) * static_cast<int>(index.size()));
+			element_layer.ibo.release();
+			element_layer.index = std::move(index);
+		}
 	}
 
-	painter.end();
+	updateElementSelection(rebuilt);
+
+	const std::array<const QColor*, 3> color{&Color.FRAME, &Color.BRACE, &Color.WALL};
+
+	bind(element_layer);
+
+	for(auto J = 0llu, first = 0llu; J < color.size(); first += element_count[J++]) {
+		if(element_count[J] == 0) continue;
+
+		visible.clear();
+		element_tree[J].cull(current_trans, deformMargin(), visible);
+		if(visible.empty()) continue;
+
+		glVertexAttrib3f(1, color[J]->redF(), color[J]->greenF(), color[J]->blueF());
+		for(const auto& [start, count] : visible) glDrawElements(GL_LINES, static_cast<GLsizei>(2 * count), GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(GLuint) * (first + 2llu * start)));
+	}
+
+	// solid members cover their lines, highlighted ones included
+	if(anySolid()) {
+		release(element_layer);
+		for(auto J = 0llu; J < element_count.size(); ++J)
+			if(solid(J)) paintSolid(J);
+		m_program->bind();
+		bind(element_layer);
+	}
+
+	// highlighted elements are drawn again on top with their own small index buffer
+	if(!element_selection_data.empty()) {
+		element_selection.bind();
+		glVertexAttrib3f(1, Color.HL.redF(), Color.HL.greenF(), Color.HL.blueF());
+		glDrawElements(GL_LINES, static_cast<GLsizei>(element_selection_data.size()), GL_UNSIGNED_INT, nullptr);
+		element_layer.ibo.bind();
+	}
+
+	release(element_layer);
 }
 
-void ModelRenderer::paintElement() {
-	std::vector<GLfloat> element_data;
-
-	auto ele_color = [&](const Database::Element& snd) {
-		if(snd.highlighted) {
-			element_data.emplace_back(Color.HL.redF());
-			element_data.emplace_back(Color.HL.greenF());
-			element_data.emplace_back(Color.HL.blueF());
-		} else if(snd.type == Database::Element::Type::Frame) {
-			element_data.emplace_back(Color.FRAME.redF());
-			element_data.emplace_back(Color.FRAME.greenF());
-			element_data.emplace_back(Color.FRAME.blueF());
-		} else if(snd.type == Database::Element::Type::Wall) {
-			element_data.emplace_back(Color.WALL.redF());
-			element_data.emplace_back(Color.WALL.greenF());
-			element_data.emplace_back(Color.WALL.blueF());
-		} else {
-			element_data.emplace_back(Color.BRACE.redF());
-			element_data.emplace_back(Color.BRACE.greenF());
-			element_data.emplace_back(Color.BRACE.blueF());
+// one instance per element of the group, in the order of its tree
+void ModelRenderer::paintSolid(const std::size_t group) {
+	auto& layer = member_layer[group];
+
+	const auto selection = model_ptr->getSelectionRevision();
+
+	if(stale(layer) || selection != member_selection[group]) {
+		member_selection[group] = selection;
+
+		const auto& element_pool = model_ptr->getElementPool();
+		const auto& wall_section_pool = model_ptr->getWallSectionPool();
+		const auto& frame_section_pool = model_ptr->getFrameSectionPool();
+		const auto& highlighted = model_ptr->getHighlighted<Database::Element>();
+
+		auto first = 0llu;
+		for(auto J = 0llu; J < group; ++J) first += element_count[J];
+		const auto member_num = static_cast<std::size_t>(element_count[group]) / 2;
+
+		std::vector<GLfloat> data;
+		data.reserve(member_stride * member_num);
+		auto& reach = member_reach[group];
+		reach = 0.f;
+		for(auto I = 0llu; I < member_num; ++I) {
+			const auto tag = element_tag[first / 2 + I];
+			const auto& element = element_pool.at(tag);
+
+			// walls are as long as the section along the orientation and as thick as the section across
+			// frames and braces are h deep towards z, or towards x when upright, and w wide across
+			// nothing is drawn around an element whose section is missing
+			std::array<GLfloat, 4> section{0.f, 0.f, 3.f, highlighted.count(tag) != 0 ? 1.f : 0.f};
+			if(Database::Element::Type::Wall == element.type) {
+				section[2] = element.orient == 2 ? 2.f : 1.f;
+				if(const auto found = wall_section_pool.find(element.section_tag); found != wall_section_pool.end() && found->second.parameter.size() > 4) {
+					section[0] = static_cast<float>(found->second.parameter[0]);
+					section[1] = static_cast<float>(found->second.parameter[4]);
+				}
+			} else if(const auto found = frame_section_pool.find(element.section_tag); found != frame_section_pool.end() && found->second.parameter.size() > 3) {
+				section[0] = static_cast<float>(found->second.parameter[3]);
+				section[1] = static_cast<float>(found->second.parameter[2]);
+			}
+			reach = std::max(reach, .5f * std::hypot(section[0], section[1]));
+
+			appendMember(data, element_layer.index[first + 2 * I], element_layer.index[first + 2 * I + 1], section);
 		}
-	};
 
-	const auto& node_pool = model_ptr->getNodePool();
-	const auto& element_pool = model_ptr->getElementPool();
+		upload(layer, std::move(data));
+	}
 
-	element_data.reserve(12 * element_pool.size());
+	const std::array<const QColor*, 3> color{&Color.FRAME, &Color.BRACE, &Color.WALL};
 
-    for(const auto& [fst, snd] : element_pool) {
-		if(snd.type == Database::Element::Type::Wall && !Switch.WALL) continue;
-		if(snd.type == Database::Element::Type::Frame && !Switch.FRAME) continue;
-		if(snd.type == Database::Element::Type::Brace && !Switch.BRACE) continue;
+	paintMember(layer, element_tree[group], member_reach[group], *color[group]);
+}
 
-		element_data.emplace_back(node_pool.at(snd.encoding.at(0)).position.x());
-		element_data.emplace_back(node_pool.at(snd.encoding.at(0)).position.y());
-		element_data.emplace_back(node_pool.at(snd.encoding.at(0)).position.z());
-		ele_color(snd);
-		element_data.emplace_back(node_pool.at(snd.encoding.at(1)).position.x());
-		element_data.emplace_back(node_pool.at(snd.encoding.at(1)).position.y());
-		element_data.emplace_back(node_pool.at(snd.encoding.at(1)).position.z());
-		ele_color(snd);
+void ModelRenderer::appendMember(std::vector<GLfloat>& data, const GLuint start, const GLuint end, const std::array<GLfloat, 4>& section) const {
+	for(const auto slot : {start, end}) data.insert(data.end(), node_layer.data.cbegin() + 6ll * slot, node_layer.data.cbegin() + 6ll * slot + 3);
+	for(const auto slot : {start, end}) data.insert(data.end(), node_displacement_data.cbegin() + 3ll * slot, node_displacement_data.cbegin() + 3ll * slot + 3);
+	data.insert(data.end(), section.cbegin(), section.cend());
+}
+
+// instances follow the given tree, so the visible clusters give the instances to draw
+void ModelRenderer::paintMember(Layer& layer, const ClusterTree& tree, const float reach, const QColor& color) {
+	if(layer.size() == 0) return;
+
+	visible.clear();
+	tree.cull(current_trans, reach + deformMargin(), visible);
+	if(visible.empty()) return;
+
+	m_member_program->bind();
+	// a light at the camera
+	m_member_program->setUniformValue(m_member_light, towardCamera());
+	m_member_program->setUniformValue(m_member_color, QVector3D(color.redF(), color.greenF(), color.blueF()));
+
+	// boxes are closed, so their back faces are never seen
+	glEnable(GL_CULL_FACE);
+
+	bind(layer);
+
+	// the box mesh and the divisors are part of the array, only the instance offset changes between ranges
+	layer.vbo.bind();
+	for(const auto& [first, count] : visible) {
+		const auto offset = sizeof(GLfloat) * member_stride * first;
+		for(auto I = 2; I < 6; ++I) glVertexAttribPointer(I, 3, GL_FLOAT, GL_FALSE, member_stride * sizeof(GLfloat), reinterpret_cast<void*>(offset + 3 * (I - 2) * sizeof(GLfloat)));
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, member_stride * sizeof(GLfloat), reinterpret_cast<void*>(offset + 12 * sizeof(GLfloat)));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, box_vertex, static_cast<GLsizei>(count));
 	}
+	layer.vbo.release();
+
+	release(layer);
 
-	m_buffer.bind();
+	glDisable(GL_CULL_FACE);
+}
 
-	m_buffer.allocate(element_data.data(), sizeof(GLfloat) * static_cast<int>(element_data.size()));
+void ModelRenderer::collectLabel() {
+	label_source.clear();
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+	const auto displacement = [](const Database::Node& node) { return QVector3D(static_cast<float>(node.displacement[0]), static_cast<float>(node.displacement[1]), static_cast<float>(node.displacement[2])); };
+
+	if(Switch.NODE_LABEL)
+		for(auto& [fst, snd] : model_ptr->getNodePool()) label_source.push_back({snd.position, displacement(snd), fst, false});
+
+	if(Switch.ELEMENT_LABEL) {
+		const auto& node_pool = model_ptr->getNodePool();
 
-	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(element_data.size() / 6));
+		for(auto& [fst, snd] : model_ptr->getElementPool()) {
+			if(snd.type == Database::Element::Type::Wall && !Switch.WALL) continue;
+			if(snd.type == Database::Element::Type::Frame && !Switch.FRAME) continue;
+			if(snd.type == Database::Element::Type::Brace && !Switch.BRACE) continue;
 
-	m_buffer.release();
+			const auto& node_i = node_pool.at(snd.encoding[0]);
+			const auto& node_j = node_pool.at(snd.encoding[1]);
+			label_source.push_back({.5f * (node_i.position + node_j.position), .5f * (displacement(node_i) + displacement(node_j)), fst, true});
+		}
+	}
 }
 
-void ModelRenderer::paintElementLabel() {
-	const auto& node_pool = model_ptr->getNodePool();
-	const auto& element_pool = model_ptr->getElementPool();
+// labels are placed over the whole picture, which is more than the current target when exporting in tiles
+void ModelRenderer::layoutLabel(const bool rebuilt) {
+	const auto view_w = static_cast<float>(scene_viewport.width());
+	const auto view_h = static_cast<float>(scene_viewport.height());
+	const auto selection = model_ptr->getSelectionRevision();
+
+	if(!rebuilt && selection == label_selection && scene_viewport == label_viewport && scene_trans == label_trans && label_cell == label_layout_cell && deform_amplitude == label_amplitude) return;
+
+	label_selection = selection;
+	label_viewport = scene_viewport;
+	label_trans = scene_trans;
+	label_layout_cell = label_cell;
+	label_amplitude = deform_amplitude;
+
+	const auto cell_w = static_cast<float>(label_cell.width());
+	const auto cell_h = static_cast<float>(label_cell.height());
+	const auto shift = QVector3D{Size.XSHIFT, Size.YSHIFT, Size.ZSHIFT};
+
+	const auto& node_selection = model_ptr->getHighlighted<Database::Node>();
+	const auto& element_selection = model_ptr->getHighlighted<Database::Element>();
+
+	struct Candidate {
+		float depth;
+		bool highlighted;
+		float x, y;
+		int digit;
+		std::size_t index;
+	};
 
-	QPainter painter(this);
-	painter.setPen(Color.HL);
+	// project and drop whatever ends outside the viewport or the depth range
+	std::vector<Candidate> candidate;
+	candidate.reserve(label_source.size());
+	for(auto I = 0llu; I < label_source.size(); ++I) {
+		const auto& label = label_source[I];
+		// placed where the shader draws it, on the deformed shape
+		const auto clip = scene_trans * QVector4D(label.position + deform_amplitude * label.displacement + shift, 1.f);
+		if(clip.w() <= 0.f || std::abs(clip.z()) > clip.w()) continue;
+
+		const auto x = (.5f + .5f * clip.x() / clip.w()) * view_w;
+		const auto y = (.5f + .5f * clip.y() / clip.w()) * view_h - label_baseline;
+		auto digit = 1;
+		for(auto value = label.tag; value >= 10; value /= 10) ++digit;
+		if(x + static_cast<float>(digit) * cell_w < 0.f || x > view_w || y + cell_h < 0.f || y > view_h) continue;
+
+		candidate.push_back({clip.z() / clip.w(), (label.element ? element_selection : node_selection).count(label.tag) != 0, x, y, digit, I});
+	}
+
+	// highlighted labels go first, the rest front to back so that a label hides the ones behind it
+	std::sort(candidate.begin(), candidate.end(), [](const Candidate& a, const Candidate& b) { return a.highlighted != b.highlighted ? a.highlighted : a.depth < b.depth; });
+
+	// one bit of occupancy per character cell on screen
+	const auto columns = static_cast<int>(std::ceil(view_w / cell_w));
+	const auto rows = static_cast<int>(std::ceil(view_h / cell_h));
+	label_grid.assign(static_cast<std::size_t>(columns) * rows, 0);
+
+	std::vector<GLfloat> data;
+	for(const auto& [depth, highlighted, x, y, digit, index] : candidate) {
+		const auto c0 = std::max(0, static_cast<int>(std::floor(x / cell_w)));
+		const auto c1 = std::min(columns - 1, static_cast<int>(std::floor((x + static_cast<float>(digit) * cell_w) / cell_w)));
+		const auto r0 = std::max(0, static_cast<int>(std::floor(y / cell_h)));
+		const auto r1 = std::min(rows - 1, static_cast<int>(std::floor((y + cell_h) / cell_h)));
+
+		auto vacant = true;
+		for(auto R = r0; R <= r1 && vacant; ++R)
+			for(auto C = c0; C <= c1 && vacant; ++C) vacant = label_grid[static_cast<std::size_t>(R) * columns + C] == 0;
+		if(!vacant) continue;
+
+		for(auto R = r0; R <= r1; ++R)
+			for(auto C = c0; C <= c1; ++C) label_grid[static_cast<std::size_t>(R) * columns + C] = 1;
+
+		appendLabel(data, label_source[index]);
+	}
+
+	upload(label_layer, std::move(data));
+}
+
+void ModelRenderer::appendLabel(std::vector<GLfloat>& data, const Label& label) {
+	// one instance per digit, placed by its column in the label
+	std::array<int, 10> digit{};
+	auto size = 0;
+	auto value = label.tag;
+	do {
+		digit[size++] = value % 10;
+		value /= 10;
+	}
+	while(value > 0 && size < static_cast<int>(digit.size()));
+
+	for(auto I = 0; I < size; ++I) appendGlyph(data, label.position, label.displacement, digit[size - 1 - I], static_cast<float>(I));
+}
+
+void ModelRenderer::paintLabel() {
+	const auto rebuilt = stale(label_layer);
+
+	if(rebuilt) collectLabel();
+
+	layoutLabel(rebuilt);
+
+	auto& layer = label_layer;
+
+	if(layer.size() == 0) return;
+
+	m_label_program->bind();
+	m_label_program->setUniformValue(m_label_shift, QVector3D{Size.XSHIFT, Size.YSHIFT, Size.ZSHIFT});
+	m_label_program->setUniformValue(m_label_cell, QVector3D(static_cast<float>(label_cell.width()), static_cast<float>(label_cell.height()), label_baseline));
+	m_label_program->setUniformValue(m_label_viewport, QVector2D(static_cast<float>(tile_viewport.width()), static_cast<float>(tile_viewport.height())));
+	m_label_program->setUniformValue(m_label_atlas, 0);
+
+	// only solid members hide labels, lines and points are thin enough to read through
+	// the depth of the solids alone is laid down again, and each label is tested at its node brought forward by the widest section
+	// so that a node inside its own member keeps its label
+	const auto occluded = anySolid();
+	if(occluded) {
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		for(auto J = 0llu; J < element_count.size(); ++J)
+			if(solid(J)) paintSolid(J);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		m_label_program->bind();
+		m_label_program->setUniformValue(m_label_toward, towardCamera());
+		m_label_program->setUniformValue(m_label_lift, *std::max_element(member_reach.cbegin(), member_reach.cend()));
+	} else glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	label_atlas->bind(0);
+
+	bind(layer);
+
+	paintGlyph(layer, glyph_quad, 6, 0, layer.size());
+
+	release(layer);
+
+	label_atlas->release(0);
+
+	glDisable(GL_BLEND);
+	if(!occluded) glEnable(GL_DEPTH_TEST);
+
+	m_program->bind();
+}
+
+void ModelRenderer::createAtlas(const qreal ratio) {
+	// digits 0 to 9 side by side, white on transparent, tinted in the shader
 	QFont font;
 	font.setPointSize(14);
-	painter.setFont(font);
+	const QFontMetricsF metrics(font);
 
-	for(auto& [fst, snd] : element_pool) {
-		if(snd.type == Database::Element::Type::Wall && !Switch.WALL) continue;
-		if(snd.type == Database::Element::Type::Frame && !Switch.FRAME) continue;
-		if(snd.type == Database::Element::Type::Brace && !Switch.BRACE) continue;
+	auto advance = 0.;
+	for(auto I = 0; I < 10; ++I) advance = std::max(advance, metrics.horizontalAdvance(QChar('0' + I)));
 
-		QVector3D position(0, 0, 0);
-		auto counter = 0.f;
-		for(auto& I : snd.encoding) {
-			position += node_pool.at(I).position;
-			counter += 1.f;
-		}
-		const auto text = QString::number(fst);
-		renderLabel(painter, position / counter + QVector3D{Size.XSHIFT, Size.YSHIFT, Size.ZSHIFT}, text);
-	}
+	const auto cell = QSizeF(std::ceil(advance), std::ceil(metrics.height()));
+
+	QImage image((QSizeF(10. * cell.width(), cell.height()) * ratio).toSize(), QImage::Format_RGBA8888);
+	image.setDevicePixelRatio(ratio);
+	image.fill(Qt::transparent);
 
+	QPainter painter(&image);
+	painter.setFont(font);
+	painter.setPen(Qt::white);
+	for(auto I = 0; I < 10; ++I) painter.drawText(QRectF(I * cell.width(), 0., cell.width(), cell.height()), Qt::AlignCenter, QString(QChar('0' + I)));
 	painter.end();
+
+	label_cell = cell * ratio;
+	label_baseline = static_cast<float>(metrics.descent() * ratio);
+
+	label_atlas = std::make_unique<QOpenGLTexture>(image, QOpenGLTexture::DontGenerateMipMaps);
+	label_atlas->setMinificationFilter(QOpenGLTexture::Linear);
+	label_atlas->setMagnificationFilter(QOpenGLTexture::Linear);
+	label_atlas->setWrapMode(QOpenGLTexture::ClampToEdge);
 }
 
 void ModelRenderer::paintBC() {
-	std::vector<GLfloat> data;
-	std::vector<GLenum> type;
+	if(stale(bc_layer)) {
+		std::array<std::vector<GLfloat>, 3> group;
+		std::array<std::vector<GLuint>, 3> slot;
+
+		// nodes are walked in vertex order, so the instances of each group follow the node clusters
+		const auto& node_pool = model_ptr->getNodePool();
+		for(auto K = 0llu; K < node_tag.size(); ++K) {
+			const auto& snd = node_pool.at(node_tag[K]);
+			for(auto I = 0; I < 3; ++I) {
+				const auto J = snd.fixity[I] && snd.fixity[I + 3llu] ? 0 : snd.fixity[I] ? 1 : snd.fixity[I + 3llu] ? 2 : -1;
+				if(J < 0) continue;
+				appendGlyph(group[J], snd.position, nodeDisplacement(K), I, 1.f);
+				slot[J].emplace_back(static_cast<GLuint>(K));
+			}
+		}
 
-	const auto& node_pool = model_ptr->getNodePool();
+		std::vector<GLfloat> data;
+		data.reserve(group[0].size() + group[1].size() + group[2].size());
+		bc_slot.clear();
+		for(auto J = 0llu; J < group.size(); ++J) {
+			bc_count[J] = static_cast<GLsizei>(group[J].size() / glyph_stride);
+			data.insert(data.end(), group[J].cbegin(), group[J].cend());
+			bc_slot.insert(bc_slot.end(), slot[J].cbegin(), slot[J].cend());
+		}
+
+		upload(bc_layer, std::move(data));
+	}
 
-	auto bc_num = 0;
+	m_glyph_program->bind();
+	m_glyph_program->setUniformValue(m_glyph_size, Size.BC);
+	m_glyph_program->setUniformValue(m_glyph_color, QVector3D(Color.BC.redF(), Color.BC.greenF(), Color.BC.blueF()));
 
-	for(const auto& [fst, snd] : node_pool) {
-		if(snd.fixity.at(0) || snd.fixity.at(3)) ++bc_num;
-		if(snd.fixity.at(1) || snd.fixity.at(4)) ++bc_num;
-		if(snd.fixity.at(2) || snd.fixity.at(5)) ++bc_num;
+	// the corners of the square are a diagonal away from the node
+	visible.clear();
+	node_tree.cull(current_trans, 1.5f * Size.BC + deformMargin(), visible);
+
+	bind(bc_layer);
+
+	paintVisibleGlyph(bc_layer, bc_slot, glyph_square, 6, 0, bc_count[0]);
+	paintVisibleGlyph(bc_layer, bc_slot, glyph_square_frame, 24, bc_count[0], bc_count[1]);
+	paintVisibleGlyph(bc_layer, bc_slot, glyph_diamond_frame, 24, bc_count[0] + bc_count[1], bc_count[2]);
+
+	release(bc_layer);
+
+	m_program->bind();
+}
+
+void ModelRenderer::paintLoad() {
+	if(stale(load_layer)) {
+		std::vector<GLfloat> data;
+
+		load_slot.clear();
+
+		const auto& node_pool = model_ptr->getNodePool();
+		for(auto K = 0llu; K < node_tag.size(); ++K) {
+			const auto& snd = node_pool.at(node_tag[K]);
+			for(auto I = 0; I < 3; ++I)
+				if(snd.load[I] != 0.) {
+					appendGlyph(data, snd.position, nodeDisplacement(K), I, snd.load[I] > 0. ? -1.f : 1.f);
+					load_slot.emplace_back(static_cast<GLuint>(K));
+				}
+		}
+
+		upload(load_layer, std::move(data));
 	}
 
-	data.reserve(24llu * bc_num);
-	type.reserve(bc_num);
+	m_glyph_program->bind();
+	m_glyph_program->setUniformValue(m_glyph_size, Size.LOAD);
+	m_glyph_program->setUniformValue(m_glyph_color, QVector3D(Color.LOAD.redF(), Color.LOAD.greenF(), Color.LOAD.blueF()));
+
+	// the arrow is six sizes long
+	visible.clear();
+	node_tree.cull(current_trans, 6.f * Size.LOAD + deformMargin(), visible);
+
+	bind(load_layer);
+
+	paintVisibleGlyph(load_layer, load_slot, glyph_arrow, 18, 0, load_layer.size());
 
-	for(const auto& [fst, snd] : node_pool) {
-		if(snd.fixity.at(0) && snd.fixity.at(3)) {
-			appendFixX(data, snd.position);
-			type.emplace_back(GL_QUADS);
-		} else if(snd.fixity.at(0)) {
-			appendFixX(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
-		} else if(snd.fixity.at(3)) {
-			appendFixRX(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
+	release(load_layer);
+
+	m_program->bind();
+}
+
+// masses are drawn as indices into the node buffer, so they move with the deformed shape
+void ModelRenderer::paintMass() {
+	if(stale(mass_layer)) {
+		// nodes are walked in vertex order, so the indices are ascending
+		std::vector<GLuint> index;
+
+		const auto& node_pool = model_ptr->getNodePool();
+		for(auto K = 0llu; K < node_tag.size(); ++K)
+			if(node_pool.at(node_tag[K]).mass > 0.) index.emplace_back(static_cast<GLuint>(K));
+
+		if(index != mass_layer.index) {
+			mass_layer.ibo.bind();
+			mass_layer.ibo.allocate(index.data(), sizeof(GLuint) * static_cast<int>(index.size()));
+			mass_layer.ibo.release();
+			mass_layer.index = std::move(index);
 		}
+	}
+
+	if(mass_layer.index.empty()) return;
+
+	visible.clear();
+	node_tree.cull(current_trans, deformMargin(), visible);
+
+	glPointSize(pixel_scale * Size.MASS);
+
+	bind(mass_layer);
+
+	glVertexAttrib3f(1, Color.MASS.redF(), Color.MASS.greenF(), Color.MASS.blueF());
+
+	const auto& index = mass_layer.index;
+	for(const auto& [start, size] : visible) {
+		const auto lower = std::lower_bound(index.cbegin(), index.cend(), start);
+		const auto upper = std::lower_bound(lower, index.cend(), start + size);
+		if(lower != upper) glDrawElements(GL_POINTS, static_cast<GLsizei>(upper - lower), GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(GLuint) * (lower - index.cbegin())));
+	}
 
-		if(snd.fixity.at(1) && snd.fixity.at(4)) {
-			appendFixY(data, snd.position);
-			type.emplace_back(GL_QUADS);
-		} else if(snd.fixity.at(1)) {
-			appendFixY(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
-		} else if(snd.fixity.at(4)) {
-			appendFixRY(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
+	release(mass_layer);
+
+	glPointSize(pixel_scale * Size.PT);
+}
+
+std::array<ModelRenderer::Layer*, 10> ModelRenderer::layers() { return {&axis_layer, &node_layer, &element_layer, &bc_layer, &load_layer, &mass_layer, &label_layer, &member_layer[0], &member_layer[1], &member_layer[2]}; }
+
+bool ModelRenderer::stale(Layer& layer) const {
+	if(layer.revision == model_revision && layer.style == style_revision) return false;
+
+	layer.revision = model_revision;
+	layer.style = style_revision;
+
+	return true;
+}
+
+void ModelRenderer::setAttributes(Layer& layer) {
+	// glyph and member layers hold their mesh and their divisors, the instance attributes are pointed per draw
+	if(layer.stride == glyph_stride) {
+		glyph_mesh.bind();
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		glyph_mesh.release();
+
+		for(const auto I : {2, 3, 5}) {
+			glEnableVertexAttribArray(I);
+			glVertexAttribDivisor(I, 1);
 		}
+		return;
+	}
 
-		if(snd.fixity.at(2) && snd.fixity.at(5)) {
-			appendFixZ(data, snd.position);
-			type.emplace_back(GL_QUADS);
-		} else if(snd.fixity.at(2)) {
-			appendFixZ(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
-		} else if(snd.fixity.at(5)) {
-			appendFixRZ(data, snd.position);
-			type.emplace_back(GL_LINE_LOOP);
+	if(layer.stride == member_stride) {
+		box_mesh.bind();
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+		box_mesh.release();
+
+		for(auto I = 2; I < 7; ++I) {
+			glEnableVertexAttribArray(I);
+			glVertexAttribDivisor(I, 1);
 		}
+		return;
 	}
 
-	m_buffer.bind();
+	// elements and masses index into the node buffer and take one colour per group
+	const auto indexed = &layer == &element_layer || &layer == &mass_layer;
+
+	auto& source = indexed ? node_layer : layer;
 
-	m_buffer.allocate(data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+	source.vbo.bind();
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+	source.vbo.release();
 
-	for(auto I = 0llu, J = 0llu; I < data.size(); I += 24, ++J) {
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(I * sizeof(GLfloat)));
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>((3 + I) * sizeof(GLfloat)));
+	if(&layer == &node_layer) {
+		node_flag.bind();
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 1, GL_UNSIGNED_BYTE, GL_TRUE, 0, nullptr);
+		node_flag.release();
+	}
 
-		glDrawArrays(type[J], 0, static_cast<GLsizei>(4));
+	// elements and masses share the displacements of the node vertices they index
+	if(&source == &node_layer) {
+		node_displacement.bind();
+		glEnableVertexAttribArray(5);
+		glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		node_displacement.release();
 	}
 
-	m_buffer.release();
+	if(indexed) layer.ibo.bind();
+	else {
+		source.vbo.bind();
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+		source.vbo.release();
+	}
 }
 
-void ModelRenderer::paintLoad() {
-	std::vector<GLfloat> data;
+void ModelRenderer::updateNodeFlag(const bool rebuilt) {
+	const auto revision = model_ptr->getSelectionRevision();
+
+	if(!rebuilt && revision == node_flag_revision) return;
 
-	auto load_num = 0;
+	node_flag_revision = revision;
+
+	std::vector<GLubyte> flag(node_slot.size(), 0);
+	for(const auto tag : model_ptr->getHighlighted<Database::Node>())
+		if(const auto slot = node_slot.find(tag); slot != node_slot.end()) flag[slot->second] = 255;
+
+	node_flag.bind();
+	if(flag.size() != node_flag_data.size()) node_flag.allocate(flag.data(), static_cast<int>(flag.size()));
+	else {
+		// a change of selection only sends the span of flags that flipped
+		const auto first = std::mismatch(flag.cbegin(), flag.cend(), node_flag_data.cbegin()).first - flag.cbegin();
+		const auto last = flag.crend() - std::mismatch(flag.crbegin(), flag.crend(), node_flag_data.crbegin()).first;
+		if(first < last) node_flag.write(static_cast<int>(first), flag.data() + first, static_cast<int>(last - first));
+	}
+	node_flag.release();
 
+	node_flag_data = std::move(flag);
+}
+
+void ModelRenderer::updateNodeDisplacement() {
 	const auto& node_pool = model_ptr->getNodePool();
 
-	for(const auto& [fst, snd] : node_pool) {
-		if(snd.load.at(0) != 0.f) ++load_num;
-		if(snd.load.at(1) != 0.f) ++load_num;
-		if(snd.load.at(2) != 0.f) ++load_num;
+	std::vector<GLfloat> data;
+	data.reserve(3 * node_tag.size());
+
+	for(auto& axis : node_shift) axis.resize(node_tag.size());
+
+	auto largest = 0.f;
+	for(auto I = 0llu; I < node_tag.size(); ++I) {
+		const auto& displacement = node_pool.at(node_tag[I]).displacement;
+		auto square = 0.f;
+		for(auto J = 0; J < 3; ++J) {
+			const auto value = static_cast<float>(displacement[J]);
+			node_shift[J][I] = value;
+			data.emplace_back(value);
+			square += value * value;
+		}
+		largest = std::max(largest, square);
 	}
 
-	data.reserve(48llu * load_num);
+	max_displacement = std::sqrt(largest);
 
-	for(const auto& [fst, snd] : node_pool) {
-		if(snd.load.at(0) != 0.f) appendLoadX(data, snd.position, snd.load.at(0));
-		if(snd.load.at(1) != 0.f) appendLoadY(data, snd.position, snd.load.at(1));
-		if(snd.load.at(2) != 0.f) appendLoadZ(data, snd.position, snd.load.at(2));
+	node_displacement.bind();
+	if(data.size() != node_displacement_data.size()) node_displacement.allocate(data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+	else {
+		// a new result changes most values, an edit of one node only sends that node
+		const auto first = std::mismatch(data.cbegin(), data.cend(), node_displacement_data.cbegin()).first - data.cbegin();
+		const auto last = data.crend() - std::mismatch(data.crbegin(), data.crend(), node_displacement_data.crbegin()).first;
+		if(first < last) node_displacement.write(sizeof(GLfloat) * static_cast<int>(first), data.data() + first, sizeof(GLfloat) * static_cast<int>(last - first));
 	}
+	node_displacement.release();
+
+	node_displacement_data = std::move(data);
+}
 
-	m_buffer.bind();
+// the trees hold the undeformed shape, so their boxes are grown by the furthest any node may have gone
+float ModelRenderer::deformMargin() const { return std::abs(deform_amplitude) * max_displacement; }
 
-	m_buffer.allocate(data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+QVector3D ModelRenderer::nodeDisplacement(const std::size_t slot) const { return {node_displacement_data[3 * slot], node_displacement_data[3 * slot + 1], node_displacement_data[3 * slot + 2]}; }
 
-	for(auto I = 0llu, J = 0llu; I < data.size(); I += 48, ++J) {
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(I * sizeof(GLfloat)));
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>((3 + I) * sizeof(GLfloat)));
+bool ModelRenderer::solid(const std::size_t group) const { return (group == 2 ? Switch.SOLID_WALL : Switch.SOLID_FRAME) && element_count[group] > 0; }
+
+bool ModelRenderer::anySolid() const {
+	for(auto J = 0llu; J < element_count.size(); ++J)
+		if(solid(J)) return true;
+	return false;
+}
+
+// the view axis taken back into model space
+QVector3D ModelRenderer::towardCamera() const {
+	QMatrix4x4 rotation;
+	rotation.rotate(View.XR, 1, 0, 0);
+	rotation.rotate(View.YR, 0, 1, 0);
+	rotation.rotate(View.ZR, 0, 0, 1);
+	return rotation.transposed().map(QVector3D(0.f, 0.f, 1.f));
+}
+
+void ModelRenderer::updateElementSelection(const bool rebuilt) {
+	const auto revision = model_ptr->getSelectionRevision();
+
+	if(!rebuilt && revision == element_selection_revision) return;
+
+	element_selection_revision = revision;
+
+	const auto& element_pool = model_ptr->getElementPool();
+
+	std::vector<GLuint> index;
+	for(const auto tag : model_ptr->getHighlighted<Database::Element>()) {
+		const auto element = element_pool.find(tag);
+		if(element == element_pool.end()) continue;
+
+		const auto& snd = element->second;
+		if(snd.type == Database::Element::Type::Wall && !Switch.WALL) continue;
+		if(snd.type == Database::Element::Type::Frame && !Switch.FRAME) continue;
+		if(snd.type == Database::Element::Type::Brace && !Switch.BRACE) continue;
 
-		glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(8));
+		index.emplace_back(node_slot.at(snd.encoding[0]));
+		index.emplace_back(node_slot.at(snd.encoding[1]));
 	}
 
-	m_buffer.release();
+	if(index == element_selection_data) return;
+
+	element_selection.bind();
+	element_selection.allocate(index.data(), sizeof(GLuint) * static_cast<int>(index.size()));
+	element_selection.release();
+
+	element_selection_data = std::move(index);
 }
 
-void ModelRenderer::paintMass() {
-	std::vector<GLfloat> node_data;
+void ModelRenderer::upload(Layer& layer, std::vector<GLfloat>&& data) {
+	layer.vbo.bind();
 
-	const auto& node_pool = model_ptr->getNodePool();
+	if(data.size() != layer.data.size()) layer.vbo.allocate(data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+	else {
+		// same layout as before, only the vertices that differ are sent
+		// moving a node touches a handful of vertices, so this is a few small glBufferSubData calls
+		constexpr auto max_run = 64;
 
-	node_data.reserve(6 * node_pool.size());
+		const auto stride = static_cast<std::size_t>(layer.stride);
 
-	for(auto& [fst, snd] : node_pool)
-		if(snd.mass > 0.) {
-			node_data.emplace_back(snd.position.x());
-			node_data.emplace_back(snd.position.y());
-			node_data.emplace_back(snd.position.z());
-			node_data.emplace_back(Color.MASS.redF());
-			node_data.emplace_back(Color.MASS.greenF());
-			node_data.emplace_back(Color.MASS.blueF());
+		std::vector<std::pair<std::size_t, std::size_t>> run;
+		for(std::size_t I = 0; I < data.size() && run.size() <= max_run; I += stride) {
+			if(std::equal(data.cbegin() + I, data.cbegin() + I + stride, layer.data.cbegin() + I)) continue;
+			if(!run.empty() && run.back().second == I) run.back().second += stride;
+			else run.emplace_back(I, I + stride);
 		}
 
-	if(node_data.size() == 0) return;
+		if(run.size() > max_run) layer.vbo.write(0, data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+		else for(const auto& [first, last] : run) layer.vbo.write(sizeof(GLfloat) * static_cast<int>(first), data.data() + first, sizeof(GLfloat) * static_cast<int>(last - first));
+	}
 
-	glPointSize(Size.MASS);
+	layer.vbo.release();
 
-	m_buffer.bind();
+	layer.data = std::move(data);
+}
 
-	m_buffer.allocate(node_data.data(), sizeof(GLfloat) * static_cast<int>(node_data.size()));
+void ModelRenderer::bind(Layer& layer) { layer.vao.bind(); }
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+void ModelRenderer::release(Layer& layer) { layer.vao.release(); }
+
+void ModelRenderer::appendGlyph(std::vector<GLfloat>& data, const QVector3D& position, const QVector3D& displacement, const int axis, const float sign) {
+	data.emplace_back(position.x());
+	data.emplace_back(position.y());
+	data.emplace_back(position.z());
+	data.emplace_back(static_cast<GLfloat>(axis));
+	data.emplace_back(sign);
+	data.emplace_back(displacement.x());
+	data.emplace_back(displacement.y());
+	data.emplace_back(displacement.z());
+}
+
+void ModelRenderer::paintGlyph(Layer& layer, const GLint first, const GLsizei count, const GLsizei first_instance, const GLsizei instance_num) {
+	if(instance_num == 0) return;
+
+	const auto offset = sizeof(GLfloat) * glyph_stride * first_instance;
+
+	layer.vbo.bind();
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, glyph_stride * sizeof(GLfloat), reinterpret_cast<void*>(offset));
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, glyph_stride * sizeof(GLfloat), reinterpret_cast<void*>(offset + 3 * sizeof(GLfloat)));
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, glyph_stride * sizeof(GLfloat), reinterpret_cast<void*>(offset + 5 * sizeof(GLfloat)));
+	layer.vbo.release();
+
+	glDrawArraysInstanced(GL_TRIANGLES, first, count, instance_num);
+}
+
+// draws the instances of one group whose nodes lie in the visible ranges
+void ModelRenderer::paintVisibleGlyph(Layer& layer, const std::vector<GLuint>& slot, const GLint first, const GLsizei count, const GLsizei first_instance, const GLsizei instance_num) {
+	if(instance_num == 0) return;
+
+	const auto begin = slot.cbegin() + first_instance;
+	const auto end = begin + instance_num;
+
+	for(const auto& [start, size] : visible) {
+		const auto lower = std::lower_bound(begin, end, start);
+		const auto upper = std::lower_bound(lower, end, start + size);
+		if(lower != upper) paintGlyph(layer, first, count, static_cast<GLsizei>(lower - slot.cbegin()), static_cast<GLsizei>(upper - lower));
+	}
+}
+
+void ModelRenderer::mousePressEvent(QMouseEvent* event) {
+	m_press_pos = m_last_pos = event->pos();
+
+	if(event->button() != Qt::LeftButton || !(event->modifiers() & Qt::ControlModifier)) {
+		// grabbing the model stops it coasting
+		dragging = true;
+		view_velocity.fill(0.f);
+		return;
+	}
+
+	region_mode = event->modifiers() & Qt::ShiftModifier ? Region::Lasso : Region::Box;
+	region = QPolygon{event->pos(), event->pos()};
+}
+
+void ModelRenderer::mouseReleaseEvent(QMouseEvent* event) {
+	if(dragging && Qt::NoButton == event->buttons()) {
+		dragging = false;
 
-	glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(node_data.size() / 6));
+		// a pause before letting go means the model was put down, not thrown
+		if(!Switch.INERTIA || frame_clock.nsecsElapsed() - last_move > 50000000) view_velocity.fill(0.f);
 
-	m_buffer.release();
+		if(std::any_of(view_velocity.cbegin(), view_velocity.cend(), [](const float speed) { return speed != 0.f; })) {
+			aim();
+			moving = true;
+			requestFrame();
+		} else if(!moving) finishMotion();
+	}
+
+	if(event->button() != Qt::LeftButton) return;
+
+	const auto click = (event->pos() - m_press_pos).manhattanLength() < QApplication::startDragDistance();
+
+	if(Region::None == region_mode) {
+		// a click picks, a drag has already turned the view
+		if(click) pick(event->pos());
+		return;
+	}
+
+	if(!click) selectRegion();
+
+	region_mode = Region::None;
+	region.clear();
 
-	glPointSize(Size.PT);
+	update();
 }
 
-void ModelRenderer::appendFixX(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
+void ModelRenderer::paintRegion() {
+	QPainter painter(this);
+	painter.setPen(QPen(Color.HL, 1., Qt::DashLine));
+	painter.setBrush(QColor(Color.HL.red(), Color.HL.green(), Color.HL.blue(), 40));
+
+	if(Region::Box == region_mode) painter.drawRect(QRect(region.point(0), region.point(1)).normalized());
+	else painter.drawPolygon(region, Qt::OddEvenFill);
+}
+
+void ModelRenderer::selectRegion() {
+	if(!model_ptr || model_ptr->getRevision() != model_revision) return;
+
+	const auto node_num = node_tag.size();
+	const auto view_w = static_cast<float>(width());
+	const auto view_h = static_cast<float>(height());
+
+	// nodes are projected in fixed size batches copied into local arrays
+	// the inner loop has a constant trip count, no branches and no aliasing, so it is compiled into SIMD lanes
+	std::vector<float> screen_x(node_num), screen_y(node_num);
+	std::vector<std::uint8_t> inside(node_num);
+	{
+		const auto* m = current_trans.constData();
+		const auto m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3], m4 = m[4], m5 = m[5], m6 = m[6], m7 = m[7];
+		const auto m8 = m[8], m9 = m[9], m10 = m[10], m11 = m[11], m12 = m[12], m13 = m[13], m14 = m[14], m15 = m[15];
+		const auto amplitude = deform_amplitude;
+
+		for(auto B = 0llu; B < node_num; B += projection_batch) {
+			const auto size = std::min<std::size_t>(projection_batch, node_num - B);
+
+			std::array<float, projection_batch> x{}, y{}, z{}, dx{}, dy{}, dz{}, sx{}, sy{};
+			std::array<std::uint8_t, projection_batch> in{};
+			std::copy_n(node_position[0].cbegin() + B, size, x.begin());
+			std::copy_n(node_position[1].cbegin() + B, size, y.begin());
+			std::copy_n(node_position[2].cbegin() + B, size, z.begin());
+			std::copy_n(node_shift[0].cbegin() + B, size, dx.begin());
+			std::copy_n(node_shift[1].cbegin() + B, size, dy.begin());
+			std::copy_n(node_shift[2].cbegin() + B, size, dz.begin());
+
+			// nodes are selected where they are drawn
+			for(auto I = 0; I < projection_batch; ++I) {
+				x[I] += amplitude * dx[I];
+				y[I] += amplitude * dy[I];
+				z[I] += amplitude * dz[I];
+			}
+
+			for(auto I = 0; I < projection_batch; ++I) {
+				const auto cx = m0 * x[I] + m4 * y[I] + m8 * z[I] + m12;
+				const auto cy = m1 * x[I] + m5 * y[I] + m9 * z[I] + m13;
+				const auto cz = m2 * x[I] + m6 * y[I] + m10 * z[I] + m14;
+				const auto cw = m3 * x[I] + m7 * y[I] + m11 * z[I] + m15;
+				sx[I] = (.5f + .5f * cx / cw) * view_w;
+				sy[I] = (.5f - .5f * cy / cw) * view_h;
+				in[I] = (cw > 0.f) & (std::abs(cz) <= cw);
+			}
+
+			std::copy_n(sx.cbegin(), size, screen_x.begin() + B);
+			std::copy_n(sy.cbegin(), size, screen_y.begin() + B);
+			std::copy_n(in.cbegin(), size, inside.begin() + B);
+		}
+	}
+
+	// the lasso is filled into a mask once, then every test is a lookup
+	QImage mask;
+	if(Region::Lasso == region_mode) {
+		mask = QImage(width(), height(), QImage::Format_Grayscale8);
+		mask.fill(0);
+		QPainter painter(&mask);
+		painter.setPen(Qt::NoPen);
+		painter.setBrush(Qt::white);
+		painter.drawPolygon(region, Qt::OddEvenFill);
+	}
 
-	data.emplace_back(x);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
+	const auto box = QRectF(QRect(region.point(0), region.point(1)).normalized());
+	const auto x0 = static_cast<float>(box.left()), x1 = static_cast<float>(box.right());
+	const auto y0 = static_cast<float>(box.top()), y1 = static_cast<float>(box.bottom());
 
-	data.emplace_back(x);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
+	const auto covered = [&](const float x, const float y) {
+		if(x < 0.f || y < 0.f || x >= view_w || y >= view_h) return false;
+		return mask.constScanLine(static_cast<int>(y))[static_cast<int>(x)] != 0;
+	};
 
-	data.emplace_back(x);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
+	if(Region::Box == region_mode)
+		for(auto I = 0llu; I < node_num; ++I) inside[I] &= screen_x[I] >= x0 && screen_x[I] <= x1 && screen_y[I] >= y0 && screen_y[I] <= y1;
+	else
+		for(auto I = 0llu; I < node_num; ++I) inside[I] &= covered(screen_x[I], screen_y[I]);
+
+	QVector<int> node;
+	for(auto I = 0llu; I < node_num; ++I)
+		if(inside[I]) node.append(node_tag[I]);
+
+	// an element needs its whole projected segment inside, which for a box means both ends
+	// a lasso may bend in between, so the segment is walked across the mask as well
+	QVector<int> element;
+	const auto& index = element_layer.index;
+	for(auto K = 0llu; K < element_tag.size(); ++K) {
+		const auto a = index[2 * K], b = index[2 * K + 1];
+		if(!inside[a] || !inside[b]) continue;
+
+		if(Region::Lasso == region_mode) {
+			const auto dx = screen_x[b] - screen_x[a], dy = screen_y[b] - screen_y[a];
+			const auto step = static_cast<int>(std::ceil(.5f * std::max(std::abs(dx), std::abs(dy))));
+			auto through = true;
+			for(auto J = 1; J < step && through; ++J) {
+				const auto t = static_cast<float>(J) / static_cast<float>(step);
+				through = covered(screen_x[a] + t * dx, screen_y[a] + t * dy);
+			}
+			if(!through) continue;
+		}
 
-	data.emplace_back(x);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
+		element.append(element_tag[K]);
+	}
+
+	emit regionSelected(node, element);
 }
 
-void ModelRenderer::appendFixY(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
+void ModelRenderer::pick(const QPoint& position) {
+	// the buffers describe the model as last drawn, wait for the next frame otherwise
+	if(!isValid() || !model_ptr || !m_program || model_ptr->getRevision() != model_revision) return;
+
+	makeCurrent();
+
+	const auto ratio = static_cast<float>(devicePixelRatioF()) * pick_scale;
+	const auto size = QSize(std::max(1, static_cast<int>(ratio * static_cast<float>(width()))), std::max(1, static_cast<int>(ratio * static_cast<float>(height()))));
+	if(!pick_target || pick_target->size() != size) pick_target = std::make_unique<QOpenGLFramebufferObject>(size, QOpenGLFramebufferObject::Depth);
+
+	const auto x = std::clamp(static_cast<int>(ratio * static_cast<float>(position.x())), 0, size.width() - 1);
+	const auto y = std::clamp(size.height() - 1 - static_cast<int>(ratio * static_cast<float>(position.y())), 0, size.height() - 1);
+
+	// points and lines are drawn a little wider so that they are easy to hit
+	const auto point_size = std::max(ratio * Size.PT, 5.f);
+	const auto line_width = std::max(ratio * Size.LINE_WIDTH, 3.f);
+
+	// a frustum around the pixel keeps the clusters elsewhere out of the pass
+	const auto reach = .5f * std::max(point_size, line_width) + 1.f;
+	QMatrix4x4 pick_trans;
+	pick_trans.scale(.5f * static_cast<float>(size.width()) / reach, .5f * static_cast<float>(size.height()) / reach, 1.f);
+	pick_trans.translate(1.f - (2.f * static_cast<float>(x) + 1.f) / static_cast<float>(size.width()), 1.f - (2.f * static_cast<float>(y) + 1.f) / static_cast<float>(size.height()), 0.f);
+	pick_trans *= current_trans;
+
+	pick_target->bind();
+	glViewport(0, 0, size.width(), size.height());
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x, y, 1, 1);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+
+	// the block may still hold the last tile of an exported image
+	updateScene();
 
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
+	m_pick_program->bind();
 
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
+	// attributes are pointed at directly in an array of their own, the layer arrays are left as they are
+	pick_vao.bind();
 
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
+	if(element_pick_revision != element_layer.revision || element_pick_style != element_layer.style) {
+		element_pick_revision = element_layer.revision;
+		element_pick_style = element_layer.style;
 
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
-}
-
-void ModelRenderer::appendFixZ(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
+		// both ends of each element in index order, drawn without indices so that the vertex gives the element
+		// each end carries its position and its displacement
+		std::vector<GLfloat> data;
+		data.reserve(6 * element_layer.index.size());
+		for(const auto I : element_layer.index) {
+			data.insert(data.end(), node_layer.data.cbegin() + 6ll * I, node_layer.data.cbegin() + 6ll * I + 3);
+			data.insert(data.end(), node_displacement_data.cbegin() + 3ll * I, node_displacement_data.cbegin() + 3ll * I + 3);
+		}
 
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
+		element_pick.bind();
+		element_pick.allocate(data.data(), sizeof(GLfloat) * static_cast<int>(data.size()));
+		element_pick.release();
+	}
 
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
+	setLineWidth(line_width);
+	m_pick_program->setUniformValue(m_pick_divisor, 2);
+	m_pick_program->setUniformValue(m_pick_kind, 2.f);
+	element_pick.bind();
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+	for(auto J = 0llu, first = 0llu; J < element_tree.size(); first += element_count[J++]) {
+		visible.clear();
+		element_tree[J].cull(pick_trans, deformMargin(), visible);
+		for(const auto& [start, count] : visible) glDrawArrays(GL_LINES, static_cast<GLint>(first + 2llu * start), static_cast<GLsizei>(2 * count));
+	}
+	element_pick.release();
+
+	// nodes go last and win over the elements meeting at them
+	glPointSize(point_size);
+	m_pick_program->setUniformValue(m_pick_divisor, 1);
+	m_pick_program->setUniformValue(m_pick_kind, 1.f);
+	node_layer.vbo.bind();
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+	node_displacement.bind();
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+	visible.clear();
+	node_tree.cull(pick_trans, deformMargin(), visible);
+	for(const auto& [first, count] : visible) glDrawArrays(GL_POINTS, static_cast<GLint>(first), static_cast<GLsizei>(count));
+	node_displacement.release();
+	pick_vao.release();
 
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
+	std::array<GLubyte, 4> pixel{};
+	glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel.data());
 
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
-}
-
-void ModelRenderer::appendFixRX(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	data.emplace_back(x);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
-}
-
-void ModelRenderer::appendFixRY(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z + Size.BC);
-	appendFixColor(data);
-
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z - Size.BC);
-	appendFixColor(data);
-}
-
-void ModelRenderer::appendFixRZ(std::vector<GLfloat>& data, const QVector3D& position) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	data.emplace_back(x - Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y + Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x + Size.BC);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendFixColor(data);
-
-	data.emplace_back(x);
-	data.emplace_back(y - Size.BC);
-	data.emplace_back(z);
-	appendFixColor(data);
-}
-
-void ModelRenderer::appendFixColor(std::vector<GLfloat>& data) const {
-	data.emplace_back(Color.BC.redF());
-	data.emplace_back(Color.BC.greenF());
-	data.emplace_back(Color.BC.blueF());
-}
-
-void ModelRenderer::appendLoadX(std::vector<GLfloat>& data, const QVector3D& position, const float load) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	const auto size = load > 0.f ? -Size.LOAD : Size.LOAD;
-	const auto size_2 = 2 * size;
-	const auto size_6 = 6 * size;
-
-	data.emplace_back(x + size_6);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x + size_2);
-	data.emplace_back(y + size);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x + size_2);
-	data.emplace_back(y - size);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x + size_2);
-	data.emplace_back(y);
-	data.emplace_back(z + size);
-	appendLoadColor(data);
-	data.emplace_back(x + size_2);
-	data.emplace_back(y);
-	data.emplace_back(z - size);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-}
-
-void ModelRenderer::appendLoadY(std::vector<GLfloat>& data, const QVector3D& position, const float load) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	const auto size = load > 0.f ? -Size.LOAD : Size.LOAD;
-	const auto size_2 = 2 * size;
-	const auto size_6 = 6 * size;
-
-	data.emplace_back(x);
-	data.emplace_back(y + size_6);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x + size);
-	data.emplace_back(y + size_2);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x - size);
-	data.emplace_back(y + size_2);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y + size_2);
-	data.emplace_back(z + size);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y + size_2);
-	data.emplace_back(z - size);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-}
-
-void ModelRenderer::appendLoadZ(std::vector<GLfloat>& data, const QVector3D& position, const float load) const {
-	const auto& x = position.x();
-	const auto& y = position.y();
-	const auto& z = position.z();
-
-	const auto size = load > 0.f ? -Size.LOAD : Size.LOAD;
-	const auto size_2 = 2 * size;
-	const auto size_6 = 6 * size;
-
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z + size_6);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y + size);
-	data.emplace_back(z + size_2);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y - size);
-	data.emplace_back(z + size_2);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-	data.emplace_back(x + size);
-	data.emplace_back(y);
-	data.emplace_back(z + size_2);
-	appendLoadColor(data);
-	data.emplace_back(x - size);
-	data.emplace_back(y);
-	data.emplace_back(z + size_2);
-	appendLoadColor(data);
-	data.emplace_back(x);
-	data.emplace_back(y);
-	data.emplace_back(z);
-	appendLoadColor(data);
-}
-
-void ModelRenderer::appendLoadRX(std::vector<GLfloat>&, const QVector3D&, float) {}
-
-void ModelRenderer::appendLoadRY(std::vector<GLfloat>&, const QVector3D&, float) {}
-
-void ModelRenderer::appendLoadRZ(std::vector<GLfloat>&, const QVector3D&, float) {}
-
-void ModelRenderer::appendLoadColor(std::vector<GLfloat>& data) const {
-	data.emplace_back(Color.LOAD.redF());
-	data.emplace_back(Color.LOAD.greenF());
-	data.emplace_back(Color.LOAD.blueF());
-}
-
-void ModelRenderer::mousePressEvent(QMouseEvent* event) { m_last_pos = event->pos(); }
+	m_pick_program->release();
+	glDisable(GL_SCISSOR_TEST);
+	pick_target->release();
+
+	doneCurrent();
+
+	const auto id = static_cast<std::size_t>(pixel[0] | pixel[1] << 8 | pixel[2] << 16);
+	if(0 == id) return;
+
+	if(1 == pixel[3] && id <= node_tag.size()) emit nodePicked(node_tag[id - 1]);
+	else if(2 == pixel[3] && id <= element_tag.size()) emit elementPicked(element_tag[id - 1]);
+}
 
 void ModelRenderer::mouseMoveEvent(QMouseEvent* event) {
+	if(Region::Box == region_mode) {
+		region.setPoint(1, event->pos());
+		update();
+		return;
+	}
+
+	if(Region::Lasso == region_mode) {
+		if((event->pos() - region.last()).manhattanLength() > 2) region.append(event->pos());
+		update();
+		return;
+	}
+
 	const auto dx = static_cast<float>(event->pos().x() - m_last_pos.x());
 	const auto dy = static_cast<float>(event->pos().y() - m_last_pos.y());
 
+	m_last_pos = event->pos();
+
+	// changes of XR, YR, ZR, XT, YT and ZT, events faster than the display only add up until the next frame
+	std::array<float, 6> delta{};
+
 	if(event->buttons() & Qt::LeftButton) {
-		setViewXR(View.XR + .5f * dy);
-		setViewYR(View.YR + .5f * dx);
+		delta[0] = .5f * dy;
+		delta[1] = .5f * dx;
 	} else if(event->buttons() & Qt::RightButton) {
-		setViewXR(View.XR + .5f * dy);
-		setViewZR(View.ZR + .5f * dx);
+		delta[0] = .5f * dy;
+		delta[2] = .5f * dx;
 	} else if(event->buttons() & Qt::MiddleButton) {
-		setViewXT(View.XT + .002f * dx * View.ZT);
-		setViewYT(View.YT + .002f * dy * View.ZT);
-	}
+		delta[3] = .002f * dx * aim().ZT;
+		delta[4] = .002f * dy * aim().ZT;
+	} else return;
 
-	m_last_pos = event->pos();
-
-	repaint();
+	moveCamera(delta);
 }
 
 void ModelRenderer::wheelEvent(QWheelEvent* event) {
-	setViewZT(View.ZT + View.ZT * static_cast<float>(event->angleDelta().y()) * .002f);
+	std::array<float, 6> delta{};
+	delta[5] = aim().ZT * static_cast<float>(event->angleDelta().y()) * .002f;
+
+	moveCamera(delta);
 
-	repaint();
+	// a wheel step has no release to end it
+	if(!dragging) view_velocity.fill(0.f);
 }
 
 void ModelRenderer::setPlane() {
-	const auto t_vec = QVector3D{View.XT, View.YT, View.ZT};
-
-	View.NEAR_PLANE = View.FAR_PLANE = t_vec.lengthSquared();
-
-	for(auto& [fst, snd] : model_ptr->getNodePool()) {
-		const auto distance = (t_vec - snd.position).lengthSquared();
-		if(distance < View.NEAR_PLANE) View.NEAR_PLANE = distance;
-		else if(distance > View.FAR_PLANE) View.FAR_PLANE = distance;
-	}
-
-	View.NEAR_PLANE = .5f * std::sqrt(View.NEAR_PLANE);
-	View.FAR_PLANE = 1.5f * std::sqrt(View.FAR_PLANE);
+	// the cached bounding box of the nodes with the origin added for the axis, taken as a sphere in eye space
+	auto bounds = model_ptr->getBounds();
+	bounds.expand(QVector3D(0.f, 0.f, 0.f));
+
+	QMatrix4x4 view_mat;
+	view_mat.translate(View.XT, View.YT, View.ZT);
+	view_mat.rotate(View.XR, 1, 0, 0);
+	view_mat.rotate(View.YR, 0, 1, 0);
+	view_mat.rotate(View.ZR, 0, 0, 1);
+
+	const auto depth = -view_mat.map(bounds.centre()).z();
+	const auto radius = bounds.radius() + deformMargin();
+
+	// same margins as before, glyphs and labels reach a bit beyond the nodes
+	View.FAR_PLANE = std::max(1.5f * (depth + radius), 1E-2f);
+	View.NEAR_PLANE = std::max(.5f * (depth - radius), 1E-4f * View.FAR_PLANE);
 }
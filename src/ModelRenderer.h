@@ -18,9 +18,17 @@
 #ifndef MODELRENDERER_H
 #define MODELRENDERER_H
 
+#include <ClusterTree.h>
 #include <PlotSetting.h>
+#include <QElapsedTimer>
 #include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QPolygon>
+#include <array>
+#include <unordered_map>
 
 class Database;
 
@@ -28,59 +36,290 @@ class ModelRenderer final : public PlotSetting {
 Q_OBJECT
 public:
 	using PlotSetting::PlotSetting;
+	~ModelRenderer() override;
 
 	void setModel(Database*);
 
+	// The current view drawn offscreen into an image of any size, tile by tile.
+	// Point sizes, line widths and labels grow with the image so that it looks like the widget at a higher resolution.
+	// Null if the size is empty or the image cannot be allocated.
+	[[nodiscard]] QImage renderImage(const QSize&);
+	// Jumps to the rotation and field of view of the given view without easing, with the model fitted in.
+	void setCamera(const PlotView&);
+
+signals:
+	// a click on a node or an element
+	void nodePicked(int);
+	void elementPicked(int);
+	// nodes and elements inside a box or lasso dragged with Ctrl, or Ctrl and Shift for the lasso
+	void regionSelected(const QVector<int>&, const QVector<int>&);
+	// frames that missed a refresh during the motion that just ended, out of all frames drawn for it
+	void framesDropped(int, int);
+
 public slots:
 	void resetView();
+	void fitModel();
+	void fitSelection();
+
+private slots:
+	void nextFrame();
 
 protected:
 	void initializeGL() override;
 	void paintGL() override;
 	void mousePressEvent(QMouseEvent*) override;
+	void mouseReleaseEvent(QMouseEvent*) override;
 	void mouseMoveEvent(QMouseEvent*) override;
 	void wheelEvent(QWheelEvent*) override;
 
 private:
 	static const char* vertexSource;
 	static const char* fragmentSource;
+	static const char* glyphSource;
+	static const char* labelSource;
+	static const char* memberSource;
+	static const char* labelFragmentSource;
+	static const char* pickSource;
+	static const char* pickFragmentSource;
+
+	// position, placement and displacement of one glyph instance: axis and sign for symbols, digit and column for labels
+	static constexpr int glyph_stride = 8;
+	// both ends, the displacements of both ends, and the section of one member instance
+	static constexpr int member_stride = 16;
+
+	// vertices of one layer, kept on the GPU and rebuilt only when the model or the style changes
+	struct Layer {
+		explicit Layer(const int S = 6)
+			: stride(S) {}
+
+		const int stride;
+		QOpenGLVertexArrayObject vao;
+		QOpenGLBuffer vbo = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+		QOpenGLBuffer ibo = QOpenGLBuffer(QOpenGLBuffer::Type::IndexBuffer);
+		std::vector<GLfloat> data;
+		std::vector<GLuint> index;
+		std::uint64_t revision = 0;
+		std::uint64_t style = 0;
+
+		[[nodiscard]] GLsizei size() const { return static_cast<GLsizei>(data.size() / stride); }
+	};
 
 	Database* model_ptr = nullptr;
 
-	QOpenGLBuffer m_buffer = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
 	std::unique_ptr<QOpenGLShaderProgram> m_program = nullptr;
+	std::unique_ptr<QOpenGLShaderProgram> m_glyph_program = nullptr;
+	std::unique_ptr<QOpenGLShaderProgram> m_label_program = nullptr;
+	std::unique_ptr<QOpenGLShaderProgram> m_pick_program = nullptr;
+	std::unique_ptr<QOpenGLShaderProgram> m_member_program = nullptr;
+
+	Layer axis_layer, node_layer, element_layer, mass_layer;
+	Layer bc_layer{glyph_stride}, load_layer{glyph_stride};
+	Layer label_layer{glyph_stride};
+	QOpenGLBuffer glyph_mesh = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+
+	// frames, braces and walls as boxes, one instance per element in the order of the tree of its colour, over a shared box mesh
+	std::array<Layer, 3> member_layer{Layer{member_stride}, Layer{member_stride}, Layer{member_stride}};
+	QOpenGLBuffer box_mesh = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+	// furthest a member reaches out of its tree box, half the diagonal of the largest section
+	std::array<float, 3> member_reach{};
+	// the highlight is part of the instances, so they are rebuilt when the selection changes
+	std::array<std::uint64_t, 3> member_selection{};
+
+	// vertex of each node in the node buffer, elements are drawn as indices into it
+	std::unordered_map<int, GLuint> node_slot;
+	// node of each vertex, vertices follow the order of the node tree
+	std::vector<int> node_tag;
+	// the same positions one axis per array, for projecting many at once
+	std::array<std::vector<float>, 3> node_position;
+	// element indices are sorted by colour: frame, brace, wall
+	std::array<GLsizei, 3> element_count{};
+	// element of each pair of indices
+	std::vector<int> element_tag;
+
+	// clusters of nodes and of the elements of each colour, the buffers above are laid out in the same order
+	// moving nodes refits the trees, only a change of the nodes or elements themselves builds them again
+	ClusterTree node_tree;
+	std::array<ClusterTree, 3> element_tree;
+	// element indices of each colour as collected, before they are put in tree order
+	std::array<std::vector<GLuint>, 3> element_source;
+	// ranges of the current frame that may be seen
+	std::vector<ClusterTree::Range> visible;
+
+	// highlight flag of each node vertex, one byte per node
+	QOpenGLBuffer node_flag = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+	std::vector<GLubyte> node_flag_data;
+	std::uint64_t node_flag_revision = 0;
+
+	// displacement of each node vertex, moved along by the amplitude in the vertex shader
+	QOpenGLBuffer node_displacement = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+	std::vector<GLfloat> node_displacement_data;
+	// the same one axis per array for selecting a region, and the length of the largest
+	std::array<std::vector<float>, 3> node_shift;
+	float max_displacement = 0.f;
+	// scale of the displacements in the current frame, zero for the undeformed shape
+	float deform_amplitude = 0.f;
+
+	// highlighted elements as indices into the node buffer, drawn over the others
+	QOpenGLBuffer element_selection = QOpenGLBuffer(QOpenGLBuffer::Type::IndexBuffer);
+	std::vector<GLuint> element_selection_data;
+	std::uint64_t element_selection_revision = 0;
+
+	// boundary condition instances are sorted by glyph: both fixed, translation fixed, rotation fixed
+	std::array<GLsizei, 3> bc_count{};
+	// node vertex of each glyph instance, ascending within each group, to find the instances of visible clusters
+	std::vector<GLuint> bc_slot, load_slot;
+
+	// uniforms shared by every program, the transformation changes for every exported tile and for picking
+	GLuint scene_block = 0;
+	// widest line the context draws, one pixel in forward compatible contexts
+	float max_line_width = 1.f;
+
+	// digits rendered once into a texture, the size of a character cell and the baseline offset are in device pixels
+	std::unique_ptr<QOpenGLTexture> label_atlas = nullptr;
+	QSizeF label_cell;
+	float label_baseline = 0.f;
+
+	// every label that may be shown, laid out again whenever the view or the selection changes
+	struct Label {
+		QVector3D position;
+		QVector3D displacement;
+		int tag;
+		bool element;
+	};
+
+	std::vector<Label> label_source;
+	std::vector<std::uint8_t> label_grid;
+	QMatrix4x4 label_trans;
+	QSizeF label_viewport;
+	QSizeF label_layout_cell;
+	float label_amplitude = 0.f;
+	std::uint64_t label_selection = 0;
+
+	std::uint64_t model_revision = 0;
+
+	// picking draws ids into an offscreen target at a fraction of the resolution, only when clicked
+	static constexpr float pick_scale = .5f;
+	std::unique_ptr<QOpenGLFramebufferObject> pick_target = nullptr;
+	// element ends in index order, drawn without indices so that each pair of vertices is one element
+	QOpenGLBuffer element_pick = QOpenGLBuffer(QOpenGLBuffer::Type::VertexBuffer);
+	QOpenGLVertexArrayObject pick_vao;
+	std::uint64_t element_pick_revision = 0;
+	std::uint64_t element_pick_style = 0;
+
+	// screen region being dragged out, two corners for a box or the whole path for a lasso
+	enum class Region {
+		None,
+		Box,
+		Lasso
+	};
+
+	Region region_mode = Region::None;
+	QPolygon region;
+
+	// input moves the target and every frame brings the view towards it, so a burst of events costs one frame
+	PlotView view_target;
+	// XR, YR, ZR, XT, YT and ZT per second, kept going after release with inertia
+	std::array<float, 6> view_velocity{};
+	bool moving = false;
+	bool dragging = false;
+
+	// while navigating only the elements and a sample of the nodes are drawn
+	// then every frame adds a level: all nodes and masses, glyphs, labels
+	static constexpr int full_detail = 3;
+	int detail = full_detail;
+	// vertex step of the node sample kept in the index buffer of the node layer
+	GLuint node_sample_stride = 1;
+
+	QElapsedTimer frame_clock;
+	qint64 last_step = 0;
+	qint64 last_move = 0;
+	// when a frame was first asked for, a frame shown more than a refresh later has dropped some
+	qint64 request_time = 0;
+	qint64 painted_request = 0;
+	int frame_count = 0;
+	int frame_dropped = 0;
+	bool painted_navigating = false;
+
+	// fraction of the widget resolution used while navigating, kept from one motion to the next
+	float view_scale = 1.f;
+	// applied to point sizes and line widths of the current frame
+	float pixel_scale = 1.f;
+
+	// transformation and size in device pixels of the whole picture, which labels are laid out over
+	QMatrix4x4 scene_trans;
+	QSizeF scene_viewport;
+	// size of the part being drawn, the same as the picture except for exported tiles
+	QSizeF tile_viewport;
+	std::unique_ptr<QOpenGLFramebufferObject> scale_target = nullptr;
 
 	QPoint m_last_pos;
-	int m_trans_mat = 0;
+	QPoint m_press_pos;
+	int m_glyph_size = 0;
+	int m_glyph_color = 0;
+	int m_label_shift = 0;
+	int m_label_cell = 0;
+	int m_label_viewport = 0;
+	int m_label_atlas = 0;
+	int m_label_toward = 0;
+	int m_label_lift = 0;
+	int m_pick_divisor = 0;
+	int m_pick_kind = 0;
+	int m_member_light = 0;
+	int m_member_color = 0;
 
 	void setPlane();
+	void paintScene(int);
+	void updateScene();
+	void setLineWidth(float);
+	void pick(const QPoint&);
+	void selectRegion();
+	void paintRegion();
+	void fitView(const QVector3D&, float);
+	void frame(PlotView&, const QVector3D&, float) const;
+
+	static std::array<float*, 6> camera(PlotView&);
+	PlotView& aim();
+	void moveCamera(const std::array<float, 6>&);
+	void stepCamera();
+	void requestFrame();
+	void finishMotion();
+	void adaptResolution(float, float);
+
+	[[nodiscard]] std::array<Layer*, 10> layers();
+	[[nodiscard]] bool stale(Layer&) const;
+	void setAttributes(Layer&);
+	void upload(Layer&, std::vector<GLfloat>&&);
+	void bind(Layer&);
+	void release(Layer&);
+	void updateNodeFlag(bool);
+	void updateNodeDisplacement();
+	[[nodiscard]] float deformMargin() const;
+	[[nodiscard]] QVector3D nodeDisplacement(std::size_t) const;
+	[[nodiscard]] bool solid(std::size_t) const;
+	[[nodiscard]] bool anySolid() const;
+	[[nodiscard]] QVector3D towardCamera() const;
+	void updateElementSelection(bool);
 
 	void paintAxis();
-	void paintNode();
-	void paintNodeLabel();
-	void paintElementLabel();
+	void paintNode(bool);
+	void paintLabel();
 	void paintElement();
 	void paintBC();
 	void paintLoad();
 	void paintMass();
+	void paintSolid(std::size_t);
+
+	void appendMember(std::vector<GLfloat>&, GLuint, GLuint, const std::array<GLfloat, 4>&) const;
+	void paintMember(Layer&, const ClusterTree&, float, const QColor&);
+
+	static void appendGlyph(std::vector<GLfloat>&, const QVector3D&, const QVector3D&, int, float);
+	void paintGlyph(Layer&, GLint, GLsizei, GLsizei, GLsizei);
+	void paintVisibleGlyph(Layer&, const std::vector<GLuint>&, GLint, GLsizei, GLsizei, GLsizei);
 
-	void appendFixX(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixY(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixZ(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixRX(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixRY(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixRZ(std::vector<GLfloat>&, const QVector3D&) const;
-	void appendFixColor(std::vector<GLfloat>&) const;
-
-	void appendLoadX(std::vector<GLfloat>&, const QVector3D&, float) const;
-	void appendLoadY(std::vector<GLfloat>&, const QVector3D&, float) const;
-	void appendLoadZ(std::vector<GLfloat>&, const QVector3D&, float) const;
-	void appendLoadRX(std::vector<GLfloat>&, const QVector3D&, float);
-	void appendLoadRY(std::vector<GLfloat>&, const QVector3D&, float);
-	void appendLoadRZ(std::vector<GLfloat>&, const QVector3D&, float);
-	void appendLoadColor(std::vector<GLfloat>&) const;
-
-	void renderLabel(QPainter&, const QVector3D&, const QString&) const;
+	static void appendLabel(std::vector<GLfloat>&, const Label&);
+	void collectLabel();
+	void layoutLabel(bool);
+	void createAtlas(qreal);
 };
 
 #endif // MODELRENDERER_H
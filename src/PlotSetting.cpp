@@ -19,155 +19,170 @@
 
 void PlotSetting::setColorBG() {
 	Color.BG = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorNode() {
 	Color.NODE = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorElement() {
 	Color.FRAME = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorTruss() {
 	Color.BRACE = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorHighlight() {
 	Color.HL = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorGrid() {
 	Color.GRID = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorBC() {
 	Color.BC = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorLoad() {
 	Color.LOAD = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorMass() {
 	Color.MASS = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setColorWall() {
 	Color.WALL = getColor();
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeGridNumber(const int F) {
 	Size.GRID_NUM = std::max(0, F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeAxis(const int F) {
 	Size.AXIS = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeGrid(const int F) {
 	if(F >= axis_ref.size()) Size.GRID = axis_ref.back();
 	else Size.GRID = axis_ref.at(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizePoint(const int F) {
 	Size.PT = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeLineWidth(const int F) {
 	Size.LINE_WIDTH = std::min(10.f, std::max(static_cast<float>(F), 0.f));
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeBC(const int F) {
 	Size.BC = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeLoad(const int F) {
 	Size.LOAD = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeXShift(const int F) {
 	Size.XSHIFT = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeYShift(const int F) {
 	Size.YSHIFT = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeZShift(const int F) {
 	Size.ZSHIFT = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSizeMass(const int F) {
 	Size.MASS = scaleSize(F);
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchAxis(const bool F) {
 	Switch.AXIS = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchGrid(const bool F) {
 	Switch.GRID = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchNodeLabel(const bool F) {
 	Switch.NODE_LABEL = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchElementLabel(const bool F) {
 	Switch.ELEMENT_LABEL = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchBC(const bool F) {
 	Switch.BC = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchLoad(const bool F) {
 	Switch.LOAD = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchFrame(const bool F) {
 	Switch.FRAME = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchBrace(const bool F) {
 	Switch.BRACE = F;
-	update();
+	restyle();
 }
 
 void PlotSetting::setSwitchWall(const bool F) {
 	Switch.WALL = F;
-	update();
+	restyle();
 }
 
+void PlotSetting::setSwitchSolidWall(const bool F) {
+	Switch.SOLID_WALL = F;
+	restyle();
+}
+
+void PlotSetting::setSwitchSolidFrame(const bool F) {
+	Switch.SOLID_FRAME = F;
+	restyle();
+}
+
+// camera behaviour only, nothing drawn changes
+void PlotSetting::setSwitchSmooth(const bool F) { Switch.SMOOTH = F; }
+
+void PlotSetting::setSwitchInertia(const bool F) { Switch.INERTIA = F; }
+
 void PlotSetting::setViewXR(const float F) {
 	View.XR = normaliseAngle(F);
 	update();
@@ -213,6 +228,34 @@ void PlotSetting::setViewFarPlane(const float F) {
 	update();
 }
 
+void PlotSetting::setResolutionAdaptive(const bool F) { Resolution.ADAPTIVE = F; }
+
+void PlotSetting::setResolutionFrameTime(const int F) { Resolution.FRAME_TIME = std::max(1.f, static_cast<float>(F)); }
+
+void PlotSetting::setResolutionMinimum(const int F) { Resolution.MINIMUM = std::min(std::max(.1f, .01f * static_cast<float>(F)), 1.f); }
+
+// only the amplitude given to the shader changes, so none of these restyle
+void PlotSetting::setDeformShow(const bool F) {
+	Deform.SHOW = F;
+	update();
+}
+
+// one hundred steps per decade, zero is the true scale
+void PlotSetting::setDeformScale(const int F) {
+	Deform.SCALE = std::pow(10.f, .01f * static_cast<float>(F));
+	update();
+}
+
+void PlotSetting::setDeformAnimate(const bool F) {
+	Deform.ANIMATE = F;
+	update();
+}
+
+void PlotSetting::restyle() {
+	++style_revision;
+	update();
+}
+
 QColor PlotSetting::getColor() {
 	auto dialog = QColorDialog(this);
 	dialog.adjustSize();
@@ -230,11 +273,11 @@ float PlotSetting::normaliseAngle(float angle) {
 
 float PlotSetting::scaleSize(const int F) { return (F >= 0 ? 1.f : -1.f) * std::powf(.01f * static_cast<float>(F >= 0 ? F : -F), 1.2f); }
 
-QMatrix4x4 PlotSetting::getTransformation() const {
+QMatrix4x4 PlotSetting::getTransformation(const float aspect) const {
 	QMatrix4x4 trans_mat;
 
 	trans_mat.setToIdentity();
-	trans_mat.perspective(View.FOV, static_cast<GLfloat>(width()) / static_cast<GLfloat>(height()), View.NEAR_PLANE, View.FAR_PLANE);
+	trans_mat.perspective(View.FOV, aspect > 0.f ? aspect : static_cast<GLfloat>(width()) / static_cast<GLfloat>(height()), View.NEAR_PLANE, View.FAR_PLANE);
 	trans_mat.translate(View.XT, View.YT, View.ZT);
 	trans_mat.rotate(View.XR, 1, 0, 0);
 	trans_mat.rotate(View.YR, 0, 1, 0);
@@ -18,9 +18,11 @@
 #ifndef PLOTSETTING_H
 #define PLOTSETTING_H
 
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLWidget>
 #include <QtWidgets>
 #include <cmath>
+#include <cstdint>
 
 #ifdef __unix
 #define powf pow
@@ -28,7 +30,7 @@
 
 extern bool FMC_DARK;
 
-class PlotSetting : public QOpenGLWidget, protected QOpenGLFunctions {
+class PlotSetting : public QOpenGLWidget, protected QOpenGLExtraFunctions {
 Q_OBJECT
 public:
 	using QOpenGLWidget::QOpenGLWidget;
@@ -70,6 +72,13 @@ public:
 		bool FRAME = true;
 		bool BRACE = true;
 		bool WALL = true;
+		// walls as panels sized by their sections, not only their centre lines
+		bool SOLID_WALL = true;
+		// frames and braces as prisms sized by their sections
+		bool SOLID_FRAME = false;
+		// camera eases towards where it is sent, and keeps turning for a moment after release
+		bool SMOOTH = false;
+		bool INERTIA = false;
 	};
 
 	struct PlotView {
@@ -85,10 +94,31 @@ public:
 		float FAR_PLANE = 0;
 	};
 
+	// resolution while navigating, full resolution is always used at rest
+	struct PlotResolution {
+		bool ADAPTIVE = true;
+		// milliseconds a frame may take, never below the refresh period of the display
+		float FRAME_TIME = 1000.f / 60.f;
+		// smallest fraction of the widget resolution
+		float MINIMUM = .35f;
+	};
+
+	// nodes and elements drawn at position plus scale times displacement, the geometry itself is never rebuilt
+	struct PlotDeform {
+		bool SHOW = false;
+		float SCALE = 1;
+		// the amplitude swings between plus and minus the scale
+		bool ANIMATE = false;
+		// seconds of one swing
+		float PERIOD = 2;
+	};
+
 	PlotSwitch Switch;
 	PlotColor Color;
 	PlotSize Size;
 	PlotView View;
+	PlotResolution Resolution;
+	PlotDeform Deform;
 public slots:
 	void setColorBG();
 	void setColorNode();
@@ -122,6 +152,10 @@ public slots:
 	void setSwitchFrame(bool);
 	void setSwitchBrace(bool);
 	void setSwitchWall(bool);
+	void setSwitchSolidWall(bool);
+	void setSwitchSolidFrame(bool);
+	void setSwitchSmooth(bool);
+	void setSwitchInertia(bool);
 
 	void setViewXR(float);
 	void setViewYR(float);
@@ -134,18 +168,34 @@ public slots:
 	void setViewNearPlane(float);
 	void setViewFarPlane(float);
 
+	void setResolutionAdaptive(bool);
+	void setResolutionFrameTime(int);
+	void setResolutionMinimum(int);
+
+	void setDeformShow(bool);
+	void setDeformScale(int);
+	void setDeformAnimate(bool);
+
 private:
 	QVector<float> axis_ref = QVector<float>{0.f, .1f, .2f, .3f, .5f, 1.f, 2.f, 3.f, 5.f, 10.f, 20.f, 30.f, 50.f, 100.f, 200.f, 300.f, 500.f, 1000.f, 2000.f, 3000.f, 5000.f, 10000.f};
 
 	QColor getColor();
 
-	static float normaliseAngle(float);
 	static float scaleSize(int);
 
 protected:
-	QMatrix4x4 getTransformation() const;
+	static float normaliseAngle(float);
+
+	// perspective at the given aspect ratio, that of the widget if zero
+	QMatrix4x4 getTransformation(float = 0.f) const;
+
+	// redraws after a change of colour, size or switch
+	void restyle();
 
 	QMatrix4x4 current_trans;
+
+	// bumped by every change of colour, size or switch, view changes do not count
+	std::uint64_t style_revision = 1;
 };
 
 #endif // PLOTSETTING_H
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2021 Theodore Chang, Minghao Li
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <Database.h>
+#include <QLocale>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+// Compile-time description of the records in the model file.
+// Each Layout lists the columns of a record and how they are split into lines.
+// Schema::read and Schema::write are generated from it, so adding a record type only needs a new Layout.
+namespace Schema {
+	// tokens are parsed in the C locale, the same as QString::toInt() and friends
+	inline const QLocale& locale() {
+		static const QLocale c = QLocale::c();
+		return c;
+	}
+
+	template<typename T> T to(QStringView);
+
+	template<> inline int to<int>(const QStringView token) { return locale().toInt(token); }
+
+	template<> inline float to<float>(const QStringView token) { return locale().toFloat(token); }
+
+	template<> inline double to<double>(const QStringView token) { return locale().toDouble(token); }
+
+	// columns, each one reads a single token into a record and writes it back
+
+	struct Tag {
+		template<typename R> static void read(int& tag, R&, const QStringView token) { tag = to<int>(token); }
+
+		template<typename R> static void write(QTextStream& output, const int tag, const R&) { output << tag; }
+	};
+
+	template<int N> struct Constant {
+		template<typename R> static void read(int&, R&, QStringView) {}
+
+		template<typename R> static void write(QTextStream& output, const int, const R&) { output << N; }
+	};
+
+	template<int I> struct Coordinate {
+		static_assert(I >= 0 && I < 3);
+
+		static void read(int&, Database::Node& record, const QStringView token) { record.position[I] = to<float>(token); }
+
+		static void write(QTextStream& output, const int, const Database::Node& record) { output << record.position[I]; }
+	};
+
+	template<int I> struct Parameter {
+		static constexpr int size = I + 1;
+
+		template<typename R> static void read(int&, R& record, const QStringView token) { record.parameter[I] = to<double>(token); }
+
+		template<typename R> static void write(QTextStream& output, const int, const R& record) { output << record.parameter[I]; }
+	};
+
+	struct SectionType {
+		static void read(int&, Database::FrameSection& record, const QStringView token) { record.type = Database::FrameSection(token.toString(), {}).type; }
+
+		static void write(QTextStream& output, const int, const Database::FrameSection& record) { output << static_cast<int>(record.type) + 1; }
+	};
+
+	template<int I> struct Connection {
+		static_assert(I >= 0 && I < 2);
+
+		static void read(int&, Database::Element& record, const QStringView token) { record.encoding[I] = to<int>(token); }
+
+		static void write(QTextStream& output, const int, const Database::Element& record) { output << record.encoding[I]; }
+	};
+
+	struct Section {
+		static void read(int&, Database::Element& record, const QStringView token) { record.section_tag = to<int>(token); }
+
+		static void write(QTextStream& output, const int, const Database::Element& record) { output << record.section_tag; }
+	};
+
+	struct Orientation {
+		static void read(int&, Database::Element& record, const QStringView token) { record.orient = to<int>(token); }
+
+		static void write(QTextStream& output, const int, const Database::Element& record) { output << record.orient; }
+	};
+
+	template<int... I> std::tuple<Parameter<I>...> parameter_columns(std::integer_sequence<int, I...>);
+
+	template<int N> using Parameters = decltype(parameter_columns(std::make_integer_sequence<int, N>()));
+
+	template<typename... T> using Concat = decltype(std::tuple_cat(std::declval<T>()...));
+
+	// layouts
+	// layout: number of columns on each line of a record
+	// numbered: records are preceded by a "! NUMBER" comment and tagged by their position
+	// spaced: records are followed by a blank line
+	// parameter: size of the parameter payload, if any
+
+	template<typename T, auto = 0> struct Layout;
+
+	template<> struct Layout<Database::Node> {
+		using Record = Database::Node;
+		using Columns = std::tuple<Tag, Coordinate<0>, Coordinate<1>, Coordinate<2>>;
+		static constexpr std::array<int, 1> layout{4};
+		static constexpr bool numbered = false;
+		static constexpr bool spaced = false;
+		static constexpr int parameter = 0;
+
+		static Record make() { return Record{}; }
+	};
+
+	template<> struct Layout<Database::FrameSection> {
+		using Record = Database::FrameSection;
+		using Columns = Concat<std::tuple<SectionType>, Parameters<4>>;
+		static constexpr std::array<int, 1> layout{5};
+		static constexpr bool numbered = true;
+		static constexpr bool spaced = false;
+		static constexpr int parameter = 4;
+
+		static Record make() { return Record{"Steel", QVector<double>(parameter, 0.)}; }
+	};
+
+	template<> struct Layout<Database::WallSection> {
+		using Record = Database::WallSection;
+		using Columns = Parameters<18>;
+		static constexpr std::array<int, 3> layout{6, 6, 6};
+		static constexpr bool numbered = true;
+		static constexpr bool spaced = true;
+		static constexpr int parameter = 18;
+
+		static Record make() { return Record{QVector<double>(parameter, 0.)}; }
+	};
+
+	template<> struct Layout<Database::Element, Database::Element::Type::Frame> {
+		using Record = Database::Element;
+		using Columns = std::tuple<Tag, Constant<1>, Connection<0>, Connection<1>, Section>;
+		static constexpr std::array<int, 1> layout{5};
+		static constexpr bool numbered = false;
+		static constexpr bool spaced = false;
+		static constexpr int parameter = 0;
+
+		static Record make() { return Record{0, {}, "Frame", 0}; }
+	};
+
+	template<> struct Layout<Database::Element, Database::Element::Type::Brace> {
+		using Record = Database::Element;
+		using Columns = std::tuple<Tag, Constant<2>, Connection<0>, Connection<1>, Section>;
+		static constexpr std::array<int, 1> layout{5};
+		static constexpr bool numbered = false;
+		static constexpr bool spaced = false;
+		static constexpr int parameter = 0;
+
+		static Record make() { return Record{0, {}, "Brace", 0}; }
+	};
+
+	template<> struct Layout<Database::Element, Database::Element::Type::Wall> {
+		using Record = Database::Element;
+		using Columns = std::tuple<Tag, Connection<0>, Connection<1>, Section, Orientation>;
+		static constexpr std::array<int, 1> layout{5};
+		static constexpr bool numbered = false;
+		static constexpr bool spaced = false;
+		static constexpr int parameter = 0;
+
+		static Record make() { return Record{0, {}, "Wall", 1}; }
+	};
+
+	// compile-time bookkeeping of the layouts
+
+	template<typename C> struct Requirement {
+		static constexpr int size = 0;
+	};
+
+	template<int I> struct Requirement<Parameter<I>> {
+		static constexpr int size = Parameter<I>::size;
+	};
+
+	template<typename C> struct MaxRequirement;
+
+	template<typename... C> struct MaxRequirement<std::tuple<C...>> {
+		static constexpr int size = std::max({0, Requirement<C>::size...});
+	};
+
+	template<std::size_t N> constexpr std::size_t total(const std::array<int, N>& layout) {
+		std::size_t sum = 0;
+		for(std::size_t I = 0; I < N; ++I) sum += static_cast<std::size_t>(layout[I]);
+		return sum;
+	}
+
+	// line of the given column
+	template<std::size_t N> constexpr std::size_t line(const std::array<int, N>& layout, std::size_t column) {
+		std::size_t I = 0;
+		while(column >= static_cast<std::size_t>(layout[I])) column -= static_cast<std::size_t>(layout[I++]);
+		return I;
+	}
+
+	// position of the given column in its line
+	template<std::size_t N> constexpr std::size_t offset(const std::array<int, N>& layout, std::size_t column) {
+		std::size_t I = 0;
+		while(column >= static_cast<std::size_t>(layout[I])) column -= static_cast<std::size_t>(layout[I++]);
+		return column;
+	}
+
+	template<typename L> constexpr bool check() {
+		static_assert(total(L::layout) == std::tuple_size_v<typename L::Columns>, "layout does not match the number of columns");
+		static_assert(MaxRequirement<typename L::Columns>::size <= L::parameter, "column exceeds the parameter payload");
+		return true;
+	}
+
+	template<typename L, typename F, std::size_t... I> void read_columns(F&& next_line, int& tag, typename L::Record& record, std::index_sequence<I...>) {
+		decltype(&next_line()) pool = nullptr;
+
+		auto fetch = [&](const std::size_t row) {
+			pool = &next_line();
+			// one check per line, the columns below index without bounds checks
+			if(pool->size() < static_cast<std::size_t>(L::layout[row])) throw std::out_of_range("record line is too short");
+		};
+
+		((offset(L::layout, I) == 0 ? fetch(line(L::layout, I)) : void(), std::tuple_element_t<I, typename L::Columns>::read(tag, record, (*pool)[offset(L::layout, I)])), ...);
+	}
+
+	template<typename L, std::size_t... I> void write_columns(QTextStream& output, const int tag, const typename L::Record& record, std::index_sequence<I...>) { ((std::tuple_element_t<I, typename L::Columns>::write(output, tag, record), output << (offset(L::layout, I) + 1 == static_cast<std::size_t>(L::layout[line(L::layout, I)]) ? '\n' : ' ')), ...); }
+
+	// reads one record, next_line is called once per line and returns the tokens of that line
+	template<typename T, auto V = 0, typename F> std::pair<int, T> read(F&& next_line) {
+		using L = Layout<T, V>;
+		static_assert(check<L>());
+
+		auto tag = 0;
+		auto record = L::make();
+
+		read_columns<L>(std::forward<F>(next_line), tag, record, std::make_index_sequence<std::tuple_size_v<typename L::Columns>>());
+
+		return {tag, std::move(record)};
+	}
+
+	template<typename T, auto V = 0> void write(QTextStream& output, const int tag, const T& record) {
+		using L = Layout<T, V>;
+		static_assert(check<L>());
+
+		if constexpr(L::numbered) output << "! NUMBER " << tag << '\n';
+
+		write_columns<L>(output, tag, record, std::make_index_sequence<std::tuple_size_v<typename L::Columns>>());
+
+		if constexpr(L::spaced) output << '\n';
+	}
+}
+
+#endif // SCHEMA_H